@@ -0,0 +1,208 @@
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "chess.h"
+#include "engines/enoki.cpp"
+
+// Microbenchmarks for the hot paths of move generation and evaluation, in
+// the spirit of Google Benchmark: every benchmark is one pass over a fixed
+// corpus of positions, repeated until it has run for at least --min-time
+// seconds, and reported as ns/op and ops/s.
+//
+// Usage: microbench [--filter SUBSTRING] [--min-time SECONDS]
+
+namespace
+{
+  // Openings, middlegames, endgames, checks, pins, en passant and promotions
+  const char *const corpus[] = {
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2",
+      "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "2r3k1/pp3ppp/2n1b3/q2pP3/3P4/P1PB1N2/5PPP/R2Q1RK1 b - - 0 18",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+      "8/k1P5/8/1K6/8/8/8/8 w - - 0 1",
+      "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 30",
+  };
+  constexpr int CORPUS_SIZE = sizeof(corpus) / sizeof(corpus[0]);
+
+  // Keeps the compiler from discarding a result it can see is unused
+  template <typename T>
+  inline void doNotOptimize(const T &value)
+  {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+}
+
+// Friend of ChessGame, so it can reach the private passes and reset the
+// per-position caches that would otherwise turn repeated calls into lookups
+class MicroBench
+{
+public:
+  MicroBench(const std::string &filter, double minSeconds) : filter(filter), minSeconds(minSeconds)
+  {
+    for (const char *fen : corpus)
+    {
+      games.emplace_back();
+      games.back().parseFEN(fen);
+      legalMoves.emplace_back();
+      games.back().generateMoves(legalMoves.back());
+    }
+  }
+
+  void runAll()
+  {
+    std::cout << std::left << std::setw(28) << "Benchmark" << std::right << std::setw(14) << "ns/op"
+              << std::setw(16) << "ops/s" << std::setw(14) << "ops" << std::endl;
+    std::cout << std::string(72, '-') << std::endl;
+
+    run("parseFEN", [&]()
+        {
+      for (int i = 0; i < CORPUS_SIZE; ++i)
+      {
+        scratch.parseFEN(corpus[i]);
+        doNotOptimize(scratch);
+      }
+      return CORPUS_SIZE; });
+
+    run("generateFEN", [&]()
+        {
+      for (ChessGame &game : games)
+      {
+        std::string fen = game.generateFEN();
+        doNotOptimize(fen);
+      }
+      return CORPUS_SIZE; });
+
+    run("generateMoves", [&]()
+        {
+      for (ChessGame &game : games)
+      {
+        game.invalidatePositionInfo(); // Time a fresh node, pins and attacks included
+        game.generateMoves(moves);
+        doNotOptimize(moves);
+      }
+      return CORPUS_SIZE; });
+
+    run("applyMove+undoMove", [&]()
+        {
+      int ops = 0;
+      for (int i = 0; i < CORPUS_SIZE; ++i)
+      {
+        for (const ChessGame::Move &move : legalMoves[i])
+        {
+          games[i].applyMove(move);
+          games[i].undoMove(move);
+        }
+        ops += legalMoves[i].size();
+      }
+      return ops; });
+
+    run("calculatePins", [&]()
+        {
+      for (ChessGame &game : games)
+      {
+        PinInfo pins = game.whiteTurn ? game.calculatePins<Color::White>(game.blackPieces)
+                                      : game.calculatePins<Color::Black>(game.whitePieces);
+        doNotOptimize(pins);
+      }
+      return CORPUS_SIZE; });
+
+    run("calculateCheckInfo", [&]()
+        {
+      for (ChessGame &game : games)
+      {
+        CheckInfo check = game.whiteTurn ? game.calculateCheckInfo<Color::White>() : game.calculateCheckInfo<Color::Black>();
+        doNotOptimize(check);
+      }
+      return CORPUS_SIZE; });
+
+    run("generateOpponentAttacks", [&]()
+        {
+      for (ChessGame &game : games)
+      {
+        game.opponentAttacks = 0;
+        if (game.whiteTurn)
+          game.generateOpponentAttacks<Color::White>();
+        else
+          game.generateOpponentAttacks<Color::Black>();
+        doNotOptimize(game.opponentAttacks);
+      }
+      return CORPUS_SIZE; });
+
+    run("EnokiEngine::evalV2", [&]()
+        {
+      for (ChessGame &game : games)
+      {
+        engine.initialize(&game);
+        game.invalidatePositionInfo(); // evalV2 counts legal moves, which needs fresh pins
+        int score = engine.evalV2();
+        doNotOptimize(score);
+      }
+      return CORPUS_SIZE; });
+  }
+
+private:
+  // Repeats `pass` (one sweep over the corpus returning its op count) until
+  // minSeconds have elapsed, after one untimed warm-up pass
+  template <typename Pass>
+  void run(const char *name, Pass pass)
+  {
+    if (!filter.empty() && std::string(name).find(filter) == std::string::npos)
+      return;
+
+    pass();
+    uint64_t ops = 0;
+    double elapsed = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (elapsed < minSeconds)
+    {
+      for (int i = 0; i < 16; ++i) // Check the clock only every few passes
+        ops += pass();
+      elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double nsPerOp = elapsed * 1e9 / ops;
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+              << std::setw(14) << std::setprecision(1) << nsPerOp
+              << std::setw(16) << std::setprecision(0) << 1e9 / nsPerOp
+              << std::setw(14) << ops << std::endl;
+  }
+
+  std::string filter;
+  double minSeconds;
+  std::vector<ChessGame> games;
+  std::vector<ChessGame::MoveList> legalMoves; // Generated once, so applyMove+undoMove times only the two calls
+  ChessGame scratch;
+  ChessGame::MoveList moves;
+  EnokiEngine engine;
+};
+
+int main(int argc, char **argv)
+{
+  std::string filter;
+  double minSeconds = 0.5;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+      filter = argv[++i];
+    else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+      minSeconds = std::stod(argv[++i]);
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--filter SUBSTRING] [--min-time SECONDS]" << std::endl;
+      return 1;
+    }
+  }
+
+  MicroBench bench(filter, minSeconds);
+  bench.runAll();
+  return 0;
+}
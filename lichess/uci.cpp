@@ -7,9 +7,11 @@
 #include <algorithm>
 #include <fstream>
 #include <ctime>
+#include <chrono>
 
-#include "/home/phild/enoki-chess/src/chess.h"           // Include your ChessGame header
-#include "/home/phild/enoki-chess/src/engines/enoki.cpp" // Include the EnokiEngine header
+#include "../src/chess.h"           // Include your ChessGame header
+#include "../src/engines/enoki.cpp" // Include the EnokiEngine header
+#include "../src/engines/bench.h"   // Fixed-depth search benchmark
 
 using std::cerr;
 using std::cout;
@@ -21,6 +23,9 @@ using std::vector;
 
 std::ofstream logFile;
 
+// ChessGame() starts from an empty board, so every reset goes through this FEN
+const string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
 // Function to write to log file
 void log(const std::string &message)
 {
@@ -51,33 +56,13 @@ static inline string trim(const string &s)
   return s.substr(a, b - a + 1);
 }
 
-// Map promotion char to your Piece enum, which uses
-// lower-case for WHITE pieces and upper-case for BLACK pieces (per chess.h).
-static Piece promotionPieceFromChar(char promo, bool whiteToMove)
-{
-  promo = (char)std::tolower((unsigned char)promo);
-  switch (promo)
-  {
-  case 'q':
-    return whiteToMove ? Piece::q : Piece::Q;
-  case 'r':
-    return whiteToMove ? Piece::r : Piece::R;
-  case 'b':
-    return whiteToMove ? Piece::b : Piece::B;
-  case 'n':
-    return whiteToMove ? Piece::n : Piece::N;
-  default:
-    return Piece::e;
-  }
-}
-
 int main()
 {
   std::ios::sync_with_stdio(false);
   std::cin.tie(nullptr);
 
   // Initialize log file
-  logFile.open("/home/phild/enoki-chess/lichess/uci.log", std::ios::app);
+  logFile.open("uci.log", std::ios::app); // In the working directory of the engine process
   if (!logFile.is_open())
   {
     std::cerr << "Warning: Could not open log file" << std::endl;
@@ -85,6 +70,7 @@ int main()
   log("UCI interface started");
 
   ChessGame game;
+  game.parseFEN(START_FEN);
   EnokiEngine engine;
   engine.initialize(&game);
 
@@ -92,6 +78,7 @@ int main()
   // We'll also respond again when "uci" is explicitly received.
   cout << "id name EnokiEngine\n";
   cout << "id author You\n";
+  cout << "option name Hash type spin default 16 min 1 max 4096\n";
   cout << "uciok\n";
   cout.flush();
 
@@ -106,12 +93,35 @@ int main()
     {
       cout << "id name EnokiEngine\n";
       cout << "id author You\n";
-      // If you expose runtime options, print `option name ...` lines here.
+      cout << "option name Hash type spin default 16 min 1 max 4096\n";
       cout << "uciok\n";
       cout.flush();
       continue;
     }
 
+    if (line.rfind("setoption", 0) == 0)
+    {
+      // setoption name <id> [value <x>]
+      istringstream ss(line);
+      string tok, name, value;
+      ss >> tok; // "setoption"
+      while (ss >> tok && tok != "value")
+      {
+        if (tok != "name")
+          name += (name.empty() ? "" : " ") + tok;
+      }
+      std::getline(ss >> std::ws, value);
+      std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c)
+                     { return std::tolower(c); });
+      if (name == "hash" && !value.empty())
+      {
+        int megabytes = std::clamp(std::atoi(value.c_str()), 1, 4096);
+        engine.setHashSize(megabytes); // Clears the table
+        log("Hash set to " + std::to_string(megabytes) + " MB");
+      }
+      continue;
+    }
+
     if (line == "isready")
     {
       cout << "readyok\n";
@@ -122,7 +132,9 @@ int main()
     if (line.rfind("ucinewgame", 0) == 0)
     {
       game = ChessGame();       // reinitialize to starting position
+      game.parseFEN(START_FEN);
       engine.initialize(&game); // rebind pointer
+      engine.clearHash();       // Entries from the previous game would only crowd the table
       continue;
     }
 
@@ -140,6 +152,7 @@ int main()
       if (posType == "startpos")
       {
         game = ChessGame(); // reset to start
+        game.parseFEN(START_FEN);
         engine.initialize(&game);
 
         // optional "moves"
@@ -244,48 +257,28 @@ int main()
       std::string fen = engine.getPtr()->generateFEN();
       log("Starting search for best move for FEN: " + fen);
 
+      auto searchStart = std::chrono::steady_clock::now();
       ChessGame::Move best = engine.getBestMove(depth);
+      long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - searchStart).count();
+      cout << "info depth " << depth << " nodes " << engine.getNodes() << " time " << elapsedMs
+           << " nps " << engine.getNodes() * 1000 / std::max(elapsedMs, 1LL) << " hashfull " << engine.hashfull() << "\n";
       fen = engine.getPtr()->generateFEN();
       log("Best move for FEN: " + fen + " at depth " + std::to_string(depth) + ": " + ChessGame::moveToString(best));
 
-      // Convert Move -> UCI string:
-      auto squareName = [&](Square s)
-      { return ChessGame::getSquareName(s); };
-      string uci = squareName(best.from) + squareName(best.to);
-      if (best.isPromotion && best.promotionPiece != Piece::e)
-      {
-        // UCI wants lowercase promo letter
-        char c = 'q';
-        switch (best.promotionPiece)
-        {
-        case Piece::q:
-        case Piece::Q:
-          c = 'q';
-          break;
-        case Piece::r:
-        case Piece::R:
-          c = 'r';
-          break;
-        case Piece::b:
-        case Piece::B:
-          c = 'b';
-          break;
-        case Piece::n:
-        case Piece::N:
-          c = 'n';
-          break;
-        default:
-          break;
-        }
-        uci.push_back(c);
-      }
-
-      // cout << "bestmove " << uci << "\n";
       cout << "bestmove " << ChessGame::moveToString(best) << "\n";
       cout.flush();
       continue;
     }
 
+    if (line.rfind("bench", 0) == 0)
+    {
+      // bench [depth N] [threads N] [hash MB]: fixed search over built-in positions,
+      // prints the total node count (a signature of the search) and NPS
+      istringstream ss(line.substr(5));
+      runBench(parseBenchOptions(ss), cout);
+      continue;
+    }
+
     if (line == "stop")
     {
       // If you add async search later, set a stop flag here.
@@ -0,0 +1,246 @@
+#include "./attacks.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define ENOKI_HAS_X86 1
+#endif
+
+namespace Attacks
+{
+    Magic rookMagics[64];
+    Magic bishopMagics[64];
+
+    namespace
+    {
+        SliderBackend activeBackend = SliderBackend::Magic;
+
+        uint64_t magicRookAttacks(uint64_t occupied, int sq)
+        {
+            const Magic &m = rookMagics[sq];
+            return m.attacks[m.index(occupied)];
+        }
+
+        uint64_t magicBishopAttacks(uint64_t occupied, int sq)
+        {
+            const Magic &m = bishopMagics[sq];
+            return m.attacks[m.index(occupied)];
+        }
+
+#ifdef ENOKI_HAS_X86
+        // Compiled for BMI2 whatever the build flags, only installed after pextSupported()
+        __attribute__((target("bmi2"))) uint64_t pextRookAttacks(uint64_t occupied, int sq)
+        {
+            const Magic &m = rookMagics[sq];
+            return m.attacks[_pext_u64(occupied, m.mask)];
+        }
+
+        __attribute__((target("bmi2"))) uint64_t pextBishopAttacks(uint64_t occupied, int sq)
+        {
+            const Magic &m = bishopMagics[sq];
+            return m.attacks[_pext_u64(occupied, m.mask)];
+        }
+#endif
+        uint64_t rookTable[0x19000];  // Shared by all 64 rook squares (102400 entries)
+        uint64_t bishopTable[0x1480]; // Shared by all 64 bishop squares (5248 entries)
+
+        const int rookSteps[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};   // N, E, S, W as {file, rank}
+        const int bishopSteps[4][2] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}}; // NE, SE, SW, NW
+
+        // Reference attack generator, only used while building the tables
+        uint64_t slidingAttacks(const int steps[4][2], int sq, uint64_t occupied)
+        {
+            uint64_t attacks = 0;
+            for (int dir = 0; dir < 4; ++dir)
+            {
+                int file = sq % 8 + steps[dir][0];
+                int rank = sq / 8 + steps[dir][1];
+                while (file >= 0 && file < 8 && rank >= 0 && rank < 8)
+                {
+                    uint64_t bb = 1ULL << (rank * 8 + file);
+                    attacks |= bb;
+                    if (occupied & bb)
+                        break; // Blocker reached, it is attacked but nothing behind it
+                    file += steps[dir][0];
+                    rank += steps[dir][1];
+                }
+            }
+            return attacks;
+        }
+
+        // xorshift64* generator, deterministic so the same magics are found every run
+        struct Prng
+        {
+            uint64_t s;
+            uint64_t next()
+            {
+                s ^= s >> 12;
+                s ^= s << 25;
+                s ^= s >> 27;
+                return s * 2685821657736338717ULL;
+            }
+            uint64_t sparse() { return next() & next() & next(); } // Few set bits make good magic candidates
+        };
+
+        void initMagics(const int steps[4][2], Magic magics[64], uint64_t *table)
+        {
+            // Seeds per rank that find a magic after few tries
+            const uint64_t seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+            uint64_t occupancy[4096], reference[4096];
+            int epoch[4096] = {}, currentEpoch = 0;
+            uint64_t *next = table;
+
+            for (int sq = 0; sq < 64; ++sq)
+            {
+                uint64_t rankEdges = (0x00000000000000FFULL | 0xFF00000000000000ULL) & ~(0x00000000000000FFULL << (sq / 8 * 8));
+                uint64_t fileEdges = (0x0101010101010101ULL | 0x8080808080808080ULL) & ~(0x0101010101010101ULL << (sq % 8));
+
+                Magic &m = magics[sq];
+                m.mask = slidingAttacks(steps, sq, 0) & ~(rankEdges | fileEdges);
+                m.shift = 64 - __builtin_popcountll(m.mask);
+                m.attacks = next;
+
+                // Enumerate every subset of the mask (Carry-Rippler) with its attack set
+                int size = 0;
+                uint64_t subset = 0;
+                do
+                {
+                    occupancy[size] = subset;
+                    reference[size] = slidingAttacks(steps, sq, subset);
+                    size++;
+                    subset = (subset - m.mask) & m.mask;
+                } while (subset);
+                next += size;
+
+                // Try random candidates until every subset lands in a slot without a
+                // destructive collision (two subsets sharing a slot with different attacks)
+                Prng rng = {seeds[sq / 8]};
+                for (int i = 0; i < size;)
+                {
+                    do
+                    {
+                        m.magic = rng.sparse();
+                    } while (__builtin_popcountll((m.magic * m.mask) >> 56) < 6);
+
+                    ++currentEpoch;
+                    for (i = 0; i < size; ++i)
+                    {
+                        unsigned idx = m.index(occupancy[i]);
+                        if (epoch[idx] < currentEpoch)
+                        {
+                            epoch[idx] = currentEpoch;
+                            m.attacks[idx] = reference[i];
+                        }
+                        else if (m.attacks[idx] != reference[i])
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Rewrites every slice so that it is indexed by the requested backend. The
+        // Carry-Rippler walk visits subsets in ascending order, which is exactly
+        // the order _pext_u64 compresses them to, so slot i is simply subset i.
+        void fillTables(const int steps[4][2], Magic magics[64], bool pext)
+        {
+            for (int sq = 0; sq < 64; ++sq)
+            {
+                Magic &m = magics[sq];
+                unsigned i = 0;
+                uint64_t subset = 0;
+                do
+                {
+                    m.attacks[pext ? i : m.index(subset)] = slidingAttacks(steps, sq, subset);
+                    i++;
+                    subset = (subset - m.mask) & m.mask;
+                } while (subset);
+            }
+        }
+
+        bool buildTables()
+        {
+            initMagics(rookSteps, rookMagics, rookTable);
+            initMagics(bishopSteps, bishopMagics, bishopTable);
+            if (pextFast())
+            {
+                setBackend(SliderBackend::Pext);
+            }
+            return true;
+        }
+    }
+
+    SliderLookup rookLookup = magicRookAttacks;
+    SliderLookup bishopLookup = magicBishopAttacks;
+
+    void init()
+    {
+        static const bool initialized = buildTables(); // Thread-safe one-time construction
+        (void)initialized;
+    }
+
+    bool pextSupported()
+    {
+#ifdef ENOKI_HAS_X86
+        static const bool supported = __builtin_cpu_supports("bmi2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    bool pextFast()
+    {
+#ifdef ENOKI_HAS_X86
+        if (!pextSupported())
+        {
+            return false;
+        }
+        if (!__builtin_cpu_is("amd"))
+        {
+            return true;
+        }
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        {
+            return false;
+        }
+        unsigned family = (eax >> 8) & 0xF;
+        if (family == 0xF)
+        {
+            family += (eax >> 20) & 0xFF; // Extended family
+        }
+        return family >= 0x19; // Zen 1 and 2 (0x17) run PEXT in microcode, one bit per cycle
+#else
+        return false;
+#endif
+    }
+
+    SliderBackend backend()
+    {
+        return activeBackend;
+    }
+
+    const char *backendName(SliderBackend backend)
+    {
+        return backend == SliderBackend::Pext ? "pext" : "magic";
+    }
+
+    bool setBackend(SliderBackend backend)
+    {
+        bool pext = backend == SliderBackend::Pext;
+        if (pext && !pextSupported())
+        {
+            return false; // Would fault with an illegal instruction on this host
+        }
+        fillTables(rookSteps, rookMagics, pext);
+        fillTables(bishopSteps, bishopMagics, pext);
+#ifdef ENOKI_HAS_X86
+        rookLookup = pext ? pextRookAttacks : magicRookAttacks;
+        bishopLookup = pext ? pextBishopAttacks : magicBishopAttacks;
+#endif
+        activeBackend = backend;
+        return true;
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef ATTACKS_H
+#define ATTACKS_H
+
+#include <cstdint>
+#include <array>
+
+// How a masked occupancy is turned into an index into the attack tables
+enum class SliderBackend : uint8_t
+{
+    Magic, // Multiply and shift, works on every CPU
+    Pext,  // BMI2 parallel bit extract, compiled into every x86 build and picked at runtime
+};
+
+// Fancy magic bitboards for sliding pieces. Each square owns a slice of a
+// shared attack table; a lookup is a mask, a multiply, a shift and a load.
+struct Magic
+{
+    uint64_t mask;     // Relevant occupancy (ray squares without the board edge)
+    uint64_t magic;    // Multiplier mapping every masked occupancy to a unique slot
+    uint64_t *attacks; // This square's slice of the shared attack table
+    unsigned shift;    // 64 - popcount(mask)
+
+    unsigned index(uint64_t occupied) const
+    {
+        return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+    }
+};
+
+namespace Attacks
+{
+    // Leaper and ray tables are generated at compile time and shared by every game
+
+    constexpr uint64_t FILE_A = 0x0101010101010101ULL;
+    constexpr uint64_t FILE_B = FILE_A << 1;
+    constexpr uint64_t FILE_G = FILE_A << 6;
+    constexpr uint64_t FILE_H = FILE_A << 7;
+
+    constexpr std::array<uint64_t, 64> makeKnightAttacks()
+    {
+        std::array<uint64_t, 64> table = {};
+        for (int sq = 0; sq < 64; ++sq)
+        {
+            uint64_t bb = 1ULL << sq;
+            table[sq] = ((bb >> 17) & ~FILE_H) |           // Down-Down-Left
+                        ((bb >> 15) & ~FILE_A) |           // Down-Down-Right
+                        ((bb >> 10) & ~(FILE_G | FILE_H)) | // Down-Left-Left
+                        ((bb >> 6) & ~(FILE_A | FILE_B)) |  // Down-Right-Right
+                        ((bb << 17) & ~FILE_A) |           // Up-Up-Right
+                        ((bb << 15) & ~FILE_H) |           // Up-Up-Left
+                        ((bb << 10) & ~(FILE_A | FILE_B)) | // Up-Right-Right
+                        ((bb << 6) & ~(FILE_G | FILE_H));   // Up-Left-Left
+        }
+        return table;
+    }
+
+    constexpr std::array<uint64_t, 64> makeKingAttacks()
+    {
+        std::array<uint64_t, 64> table = {};
+        for (int sq = 0; sq < 64; ++sq)
+        {
+            uint64_t bb = 1ULL << sq;
+            uint64_t row = bb | ((bb << 1) & ~FILE_A) | ((bb >> 1) & ~FILE_H); // The king square and its neighbours on the rank
+            table[sq] = (row | (row << 8) | (row >> 8)) & ~bb;
+        }
+        return table;
+    }
+
+    // Rays indexed [square][Direction] (NW, N, NE, E, SE, S, SW, W), excluding the square itself
+    constexpr std::array<std::array<uint64_t, 8>, 64> makeRayAttacks()
+    {
+        constexpr int fileSteps[8] = {-1, 0, 1, 1, 1, 0, -1, -1};
+        constexpr int rankSteps[8] = {1, 1, 1, 0, -1, -1, -1, 0};
+        std::array<std::array<uint64_t, 8>, 64> table = {};
+        for (int sq = 0; sq < 64; ++sq)
+        {
+            for (int dir = 0; dir < 8; ++dir)
+            {
+                uint64_t ray = 0;
+                int file = sq % 8 + fileSteps[dir];
+                int rank = sq / 8 + rankSteps[dir];
+                while (file >= 0 && file < 8 && rank >= 0 && rank < 8)
+                {
+                    ray |= 1ULL << (rank * 8 + file);
+                    file += fileSteps[dir];
+                    rank += rankSteps[dir];
+                }
+                table[sq][dir] = ray;
+            }
+        }
+        return table;
+    }
+
+    // [from][to]: squares strictly between two aligned squares plus `to` itself, 0 when not aligned
+    constexpr std::array<std::array<uint64_t, 64>, 64> makeBetweenTable()
+    {
+        constexpr auto rays = makeRayAttacks();
+        std::array<std::array<uint64_t, 64>, 64> table = {};
+        for (int from = 0; from < 64; ++from)
+        {
+            for (int dir = 0; dir < 8; ++dir)
+            {
+                uint64_t walked = 0;
+                uint64_t ray = rays[from][dir];
+                // Rays grow away from `from`, so walk them nearest square first
+                bool upwards = dir <= 3; // NW, N, NE, E increase the square index
+                while (ray)
+                {
+                    uint64_t bb = upwards ? (ray & (0 - ray)) : (1ULL << (63 - __builtin_clzll(ray)));
+                    ray ^= bb;
+                    walked |= bb;
+                    table[from][__builtin_ctzll(bb)] = walked;
+                }
+            }
+        }
+        return table;
+    }
+
+    // [a][b]: the whole rank, file or diagonal through two aligned squares, 0 when not aligned
+    constexpr std::array<std::array<uint64_t, 64>, 64> makeLineTable()
+    {
+        constexpr auto rays = makeRayAttacks();
+        std::array<std::array<uint64_t, 64>, 64> table = {};
+        for (int a = 0; a < 64; ++a)
+        {
+            for (int dir = 0; dir < 4; ++dir)
+            {
+                uint64_t line = rays[a][dir] | rays[a][dir + 4] | (1ULL << a); // A direction and its opposite
+                uint64_t squares = rays[a][dir] | rays[a][dir + 4];
+                while (squares)
+                {
+                    int b = __builtin_ctzll(squares);
+                    squares &= squares - 1;
+                    table[a][b] = line;
+                }
+            }
+        }
+        return table;
+    }
+
+    extern Magic rookMagics[64];
+    extern Magic bishopMagics[64];
+
+    // One lookup per backend; setBackend() points these at the active pair so
+    // callers pay one indirect call instead of a branch on every lookup
+    using SliderLookup = uint64_t (*)(uint64_t occupied, int sq);
+    extern SliderLookup rookLookup;
+    extern SliderLookup bishopLookup;
+
+    // Builds the magic tables once per process; later calls are no-ops. The
+    // backend is resolved here: PEXT on hosts where it is faster than the
+    // multiply (pextFast()), the magic lookup everywhere else.
+    void init();
+
+    bool pextSupported(); // Runtime CPUID check, true when the host has BMI2
+    bool pextFast();      // BMI2 without the microcoded PEXT of AMD before Zen 3 (family 0x19)
+    SliderBackend backend();
+    const char *backendName(SliderBackend backend);
+
+    // Re-lays out the attack tables for another backend. Returns false if this
+    // host cannot run it. Not thread-safe: only call while no game is searching.
+    bool setBackend(SliderBackend backend);
+
+    inline uint64_t rookAttacks(uint64_t occupied, int sq)
+    {
+        return rookLookup(occupied, sq);
+    }
+
+    inline uint64_t bishopAttacks(uint64_t occupied, int sq)
+    {
+        return bishopLookup(occupied, sq);
+    }
+}
+
+#endif // ATTACKS_H
@@ -1,20 +1,39 @@
 #include "./chess.h"
+#include "./attacks.h"
+#include "./zobrist.h"
+#include "./psqt.h"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <sstream>
 #include <bitset>
+#include <algorithm>
+
+static inline uint64_t pieceKey(Piece piece, int sq)
+{
+    return Zobrist::keys.pieceSquare[static_cast<int>(piece) - 1][sq];
+}
+
+static inline int pieceMaterial(Piece piece)
+{
+    return PSQT::material[static_cast<int>(piece) - 1];
+}
+
+static inline int pieceSquareValue(Piece piece, int sq)
+{
+    return PSQT::tables.pieceSquare[static_cast<int>(piece) - 1][sq];
+}
 
 ChessGame::ChessGame() : whiteTurn(true)
 {
     // Initialize the chessboard with pieces in their starting positions
-    initializeKnightAttacks();
-    initializeKingAttacks();
-    initializeRayAttacks();
-    movesVector = std::vector<Move>();
-    movesPlayed = std::vector<Move>();
-    currentState = new StateInfo();
-    currentState->castlingRights = 0b1111; // All castling rights available at the start
+    Attacks::init(); // Magic tables are shared by every game, only the first call builds them
+    stateStack.resize(INITIAL_STACK_PLY);
+    movesPlayed.resize(INITIAL_STACK_PLY);
+    currentState()->castlingRights = 0b1111; // All castling rights available at the start
+    currentState()->key = computeZobristKey();
+    currentState()->material = computeMaterialScore();
+    currentState()->pieceSquare = computePieceSquareScore();
     // parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"); // Set to starting position
     // preworkPosition();
 }
@@ -93,42 +112,33 @@ void ChessGame::printBoard(bool withBitboards)
 
 bool ChessGame::makeMove(const std::string &moveStr)
 {
-    Move move = {};
-    move.from = static_cast<Square>(ChessGame::parseSquare(moveStr.substr(0, 2)));
-    move.to = static_cast<Square>(ChessGame::parseSquare(moveStr.substr(2, 2)));
-    if (moveStr.length() == 5)
-    {
-        move.isPromotion = true;
-        switch (moveStr[4])
-        {
-        case 'q':
-            move.promotionPiece = Piece::Q;
-            break;
-        case 'r':
-            move.promotionPiece = Piece::R;
-            break;
-        case 'b':
-            move.promotionPiece = Piece::B;
-            break;
-        case 'n':
-            move.promotionPiece = Piece::N;
-            break;
-        }
-    }
-    if (getMove(move) == Move{})
+    Move move = moveFromString(moveStr);
+    if (move == Move{})
     {
-        return false; // Move not found in our moves vector
+        return false; // Not a legal move in this position
     }
-    applyMove(getMove(move));
+    applyMove(move);
+    preworkPosition(); // Keep the game-over state and the cached move list current for players
     return true;
 }
 
-ChessGame::Move ChessGame::getMove(const ChessGame::Move &move) const
+ChessGame::Move ChessGame::moveFromString(const std::string &moveStr) const
 {
-    // Check if move is in our moves vector
-    for (const Move &m : movesVector)
+    if (moveStr.length() < 4)
+    {
+        return Move{};
+    }
+    int from = ChessGame::parseSquare(moveStr.substr(0, 2));
+    int to = ChessGame::parseSquare(moveStr.substr(2, 2));
+    char promotion = moveStr.length() == 5 ? moveStr[4] : ' ';
+
+    // The UCI string carries no flags, so take them from the matching generated move
+    MoveList moves;
+    generateMoves(moves);
+    for (const Move &m : moves)
     {
-        if ((m.to == move.to) && m.from == move.from && m.promotionPiece == move.promotionPiece) // Assuming you have an equals method in Move
+        if (static_cast<int>(m.from()) == from && static_cast<int>(m.to()) == to &&
+            (m.isPromotion() ? "nbrq"[m.flags() & 3] : ' ') == promotion)
         {
             return m;
         }
@@ -138,127 +148,136 @@ ChessGame::Move ChessGame::getMove(const ChessGame::Move &move) const
 
 void ChessGame::applyMove(const ChessGame::Move &move)
 {
-    StateInfo *newState = new StateInfo();
-    newState->previousState = currentState; // Link to the previous state
-    currentState = newState;
+    if (stateIndex + 1 == stateStack.size())
+    {
+        stateStack.resize(stateStack.size() * 2); // Only the first line this deep gets here
+        movesPlayed.resize(stateStack.size());
+    }
+    const StateInfo &previousState = stateStack[stateIndex++];
+    StateInfo *newState = currentState();
+    newState->capturedPiece = Piece::e;
+    newState->enPassantSquare = Square::a1;
 
     // Copy over castling rights before processing move
-    currentState->castlingRights = currentState->previousState->castlingRights;
+    newState->castlingRights = previousState.castlingRights;
+
+    // The side to move flips and the old castling rights and en passant file are hashed out
+    uint64_t key = previousState.key ^ Zobrist::keys.blackToMove ^ Zobrist::keys.castling[previousState.castlingRights & 0xF];
+    if (enPassantHashed(previousState.enPassantSquare))
+    {
+        key ^= Zobrist::keys.enPassantFile[static_cast<int>(previousState.enPassantSquare) % 8];
+    }
+    // Material only changes on captures and promotions, the square score on every move
+    int material = previousState.material;
+    int pieceSquare = previousState.pieceSquare;
 
-    uint64_t fromBB = 1ULL << static_cast<int>(move.from);
-    uint64_t toBB = 1ULL << static_cast<int>(move.to);
+    int from = static_cast<int>(move.from());
+    int to = static_cast<int>(move.to());
 
     // Find piece at square
-    Piece piece = getPieceAtSquareFromBB(move.from);
+    Piece piece = board[from];
     if (piece == Piece::e)
     {
         std::cerr << "No piece at source square." << std::endl;
         return; // No piece to move
     }
-    else if (piece == Piece::p || piece == Piece::P)
+    else if (move.isDoublePawnPush())
     {
-        if (whiteTurn)
-        {
-            if ((move.from >= Square::a2 && move.from <= Square::h2) && (move.to >= Square::a4 && move.to <= Square::h4))
-            {
-                currentState->enPassantSquare = static_cast<Square>(static_cast<int>(move.to) - 8); // Set en passant target square
-            }
-        }
-        else
-        {
-            if ((move.from >= Square::a7 && move.from <= Square::h7) && (move.to >= Square::a5 && move.to <= Square::h5))
-            {
-                currentState->enPassantSquare = static_cast<Square>(static_cast<int>(move.to) + 8); // Set en passant target square
-            }
-        }
+        // The en passant target is the square the pawn skipped over
+        currentState()->enPassantSquare = static_cast<Square>(static_cast<int>(move.to()) + (whiteTurn ? -8 : 8));
     }
 
     // Remove piece from source square
-    pieceBitboards[static_cast<int>(piece) - 1] &= ~fromBB;
+    key ^= pieceKey(piece, from);
+    pieceSquare -= pieceSquareValue(piece, from);
+    removePiece(from);
 
-    if (move.isEnPassant)
+    if (move.isEnPassant())
     {
-        int enemyPawnSquare = static_cast<int>(move.to) - (whiteTurn ? 8 : -8);
-        Piece capturedPiece = getPieceAtSquareFromBB(static_cast<Square>(enemyPawnSquare));
-        if (capturedPiece != Piece::e)
-        {
-            currentState->capturedPiece = capturedPiece; // Store captured piece
-        }
+        int enemyPawnSquare = to - (whiteTurn ? 8 : -8);
+        currentState()->capturedPiece = board[enemyPawnSquare]; // Store captured piece
+        key ^= pieceKey(board[enemyPawnSquare], enemyPawnSquare);
+        material -= pieceMaterial(board[enemyPawnSquare]);
+        pieceSquare -= pieceSquareValue(board[enemyPawnSquare], enemyPawnSquare);
         // Remove the pawn that was captured en passant
-        pieceBitboards[static_cast<int>(capturedPiece) - 1] &= ~(1ULL << enemyPawnSquare);
-        currentState->enPassantSquare = Square::a1; // Reset en passant square after capture
+        removePiece(enemyPawnSquare);
+        currentState()->enPassantSquare = Square::a1; // Reset en passant square after capture
     }
-    else if (move.isCapture)
+    else if (move.isCapture())
     {
         // If it's a capture, remove the captured piece from its bitboard
-        Piece capturedPiece = getPieceAtSquareFromBB(move.to);
+        Piece capturedPiece = board[to];
         if (capturedPiece != Piece::e)
         {
-            pieceBitboards[static_cast<int>(capturedPiece) - 1] &= ~toBB;
+            key ^= pieceKey(capturedPiece, to);
+            material -= pieceMaterial(capturedPiece);
+            pieceSquare -= pieceSquareValue(capturedPiece, to);
+            removePiece(to);
         }
-        currentState->capturedPiece = capturedPiece; // Store captured piece
+        currentState()->capturedPiece = capturedPiece; // Store captured piece
 
         if (capturedPiece == Piece::r)
         {
-            if (move.to == Square::a1)
+            if (move.to() == Square::a1)
             {
-                currentState->castlingRights &= 0b1011;
+                currentState()->castlingRights &= 0b1011;
             }
-            if (move.to == Square::h1)
+            if (move.to() == Square::h1)
             {
-                currentState->castlingRights &= 0b0111;
+                currentState()->castlingRights &= 0b0111;
             }
         }
         else if (capturedPiece == Piece::R)
         {
-            if (move.to == Square::a8)
+            if (move.to() == Square::a8)
             {
-                currentState->castlingRights &= 0b1110;
+                currentState()->castlingRights &= 0b1110;
             }
-            if (move.to == Square::h8)
+            if (move.to() == Square::h8)
             {
-                currentState->castlingRights &= 0b1101;
+                currentState()->castlingRights &= 0b1101;
             }
         }
     }
 
     // Add piece to destination square
-    if (move.isPromotion)
-    {
-        pieceBitboards[static_cast<int>(move.promotionPiece) - 1 - (whiteTurn ? 6 : 0)] |= toBB;
-    }
-    else
-    {
-        pieceBitboards[static_cast<int>(piece) - 1] |= toBB;
-    }
+    Piece placed = move.isPromotion() ? static_cast<Piece>(static_cast<int>(move.promotionPiece()) - (whiteTurn ? 6 : 0)) : piece;
+    key ^= pieceKey(placed, to);
+    material += pieceMaterial(placed) - pieceMaterial(piece); // Non-zero only for promotions
+    pieceSquare += pieceSquareValue(placed, to);
+    putPiece(placed, to);
 
-    if (move.isCastling)
+    if (move.isCastling())
     {
-        switch (move.to)
+        switch (move.to())
         {
         case Square::g1:
             // Kingside castling for white
-            pieceBitboards[static_cast<int>(Piece::r) - 1] |= (1ULL << static_cast<int>(Square::f1));  // Place rook on f1
-            pieceBitboards[static_cast<int>(Piece::r) - 1] &= ~(1ULL << static_cast<int>(Square::h1)); // Remove rook from h1
-            currentState->castlingRights &= 0b0011;                                                    // Remove kingside and queenside castling right for white
+            movePiece(static_cast<int>(Square::h1), static_cast<int>(Square::f1)); // Rook h1 -> f1
+            key ^= pieceKey(Piece::r, static_cast<int>(Square::h1)) ^ pieceKey(Piece::r, static_cast<int>(Square::f1));
+            pieceSquare += pieceSquareValue(Piece::r, static_cast<int>(Square::f1)) - pieceSquareValue(Piece::r, static_cast<int>(Square::h1));
+            currentState()->castlingRights &= 0b0011;                                                    // Remove kingside and queenside castling right for white
             break;
         case Square::c1:
             // Queenside castling for white
-            pieceBitboards[static_cast<int>(Piece::r) - 1] |= (1ULL << static_cast<int>(Square::d1));  // Place rook on d1
-            pieceBitboards[static_cast<int>(Piece::r) - 1] &= ~(1ULL << static_cast<int>(Square::a1)); // Remove rook from a1
-            currentState->castlingRights &= 0b0011;                                                    // Remove kingside and queenside castling right for white
+            movePiece(static_cast<int>(Square::a1), static_cast<int>(Square::d1)); // Rook a1 -> d1
+            key ^= pieceKey(Piece::r, static_cast<int>(Square::a1)) ^ pieceKey(Piece::r, static_cast<int>(Square::d1));
+            pieceSquare += pieceSquareValue(Piece::r, static_cast<int>(Square::d1)) - pieceSquareValue(Piece::r, static_cast<int>(Square::a1));
+            currentState()->castlingRights &= 0b0011;                                                    // Remove kingside and queenside castling right for white
             break;
         case Square::g8:
             // Kingside castling for black
-            pieceBitboards[static_cast<int>(Piece::R) - 1] |= (1ULL << static_cast<int>(Square::f8));  // Place rook on f8
-            pieceBitboards[static_cast<int>(Piece::R) - 1] &= ~(1ULL << static_cast<int>(Square::h8)); // Remove rook from h8
-            currentState->castlingRights &= 0b1100;                                                    // Remove kingside and queenside castling right for black
+            movePiece(static_cast<int>(Square::h8), static_cast<int>(Square::f8)); // Rook h8 -> f8
+            key ^= pieceKey(Piece::R, static_cast<int>(Square::h8)) ^ pieceKey(Piece::R, static_cast<int>(Square::f8));
+            pieceSquare += pieceSquareValue(Piece::R, static_cast<int>(Square::f8)) - pieceSquareValue(Piece::R, static_cast<int>(Square::h8));
+            currentState()->castlingRights &= 0b1100;                                                    // Remove kingside and queenside castling right for black
             break;
         case Square::c8:
             // Queenside castling for black
-            pieceBitboards[static_cast<int>(Piece::R) - 1] |= (1ULL << static_cast<int>(Square::d8));  // Place rook on d8
-            pieceBitboards[static_cast<int>(Piece::R) - 1] &= ~(1ULL << static_cast<int>(Square::a8)); // Remove rook from a8
-            currentState->castlingRights &= 0b1100;                                                    // Remove kingside and queenside castling right for black
+            movePiece(static_cast<int>(Square::a8), static_cast<int>(Square::d8)); // Rook a8 -> d8
+            key ^= pieceKey(Piece::R, static_cast<int>(Square::a8)) ^ pieceKey(Piece::R, static_cast<int>(Square::d8));
+            pieceSquare += pieceSquareValue(Piece::R, static_cast<int>(Square::d8)) - pieceSquareValue(Piece::R, static_cast<int>(Square::a8));
+            currentState()->castlingRights &= 0b1100;                                                    // Remove kingside and queenside castling right for black
             break;
 
         default:
@@ -271,52 +290,111 @@ void ChessGame::applyMove(const ChessGame::Move &move)
         // If the moved piece is a king, update the castling rights
         if (piece == Piece::k) // White king
         {
-            currentState->castlingRights &= 0b0011; // Remove all castling rights for white
+            currentState()->castlingRights &= 0b0011; // Remove all castling rights for white
         }
         else // Black king
         {
-            currentState->castlingRights &= 0b1100; // Remove all castling rights for black
+            currentState()->castlingRights &= 0b1100; // Remove all castling rights for black
         }
     }
 
     if (piece == Piece::r || piece == Piece::R)
     {
-        switch (move.from)
+        switch (move.from())
         {
         case Square::a1:
-            currentState->castlingRights &= 0b1011; // Remove queenside castling right for white
+            currentState()->castlingRights &= 0b1011; // Remove queenside castling right for white
             break;
         case Square::h1:
-            currentState->castlingRights &= 0b0111; // Remove kingside castling right for white
+            currentState()->castlingRights &= 0b0111; // Remove kingside castling right for white
             break;
         case Square::a8:
-            currentState->castlingRights &= 0b1110; // Remove queenside cast
+            currentState()->castlingRights &= 0b1110; // Remove queenside cast
             break;
         case Square::h8:
-            currentState->castlingRights &= 0b1101; // Remove kingside castling right for black
+            currentState()->castlingRights &= 0b1101; // Remove kingside castling right for black
             break;
         default:
             break;
         }
     }
 
-    movesPlayed.push_back(move); // Store the move in the history
+    movesPlayed[stateIndex] = move; // Store the move in the history
 
     whiteTurn = !whiteTurn;
-    preworkPosition(); // Update the board state after the move
-    // printf("Move applied: %s to %s\n", ChessGame::getSquareName(move.from).c_str(), ChessGame::getSquareName(move.to).c_str());
+
+    key ^= Zobrist::keys.castling[currentState()->castlingRights & 0xF];
+    if (enPassantHashed(currentState()->enPassantSquare))
+    {
+        key ^= Zobrist::keys.enPassantFile[static_cast<int>(currentState()->enPassantSquare) % 8];
+    }
+    currentState()->key = key;
+    currentState()->material = material;
+    currentState()->pieceSquare = pieceSquare;
+
+    updateOccupancy();
+    invalidatePositionInfo(); // Pins and checks are computed when the position is first queried
+    // printf("Move applied: %s to %s\n", ChessGame::getSquareName(move.from()).c_str(), ChessGame::getSquareName(move.to()).c_str());
 }
 
-Piece ChessGame::getPieceAtSquareFromBB(Square square) const
+bool ChessGame::enPassantHashed(Square enPassantSquare) const
 {
-    for (int i = 0; i < 12; ++i)
+    if (enPassantSquare == Square::a1)
     {
-        if (pieceBitboards[i] & (1ULL << static_cast<int>(square)))
+        return false;
+    }
+    // Our pawns attack the square exactly where an enemy pawn on it would attack
+    uint64_t bb = 1ULL << static_cast<int>(enPassantSquare);
+    return whiteTurn ? (pawnAttacks<Color::Black>(bb) & pieceBitboards[0]) != 0
+                     : (pawnAttacks<Color::White>(bb) & pieceBitboards[6]) != 0;
+}
+
+uint64_t ChessGame::computeZobristKey() const
+{
+    uint64_t key = 0;
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        if (board[sq] != Piece::e)
+        {
+            key ^= pieceKey(board[sq], sq);
+        }
+    }
+    key ^= Zobrist::keys.castling[currentState()->castlingRights & 0xF];
+    if (enPassantHashed(currentState()->enPassantSquare))
+    {
+        key ^= Zobrist::keys.enPassantFile[static_cast<int>(currentState()->enPassantSquare) % 8];
+    }
+    if (!whiteTurn)
+    {
+        key ^= Zobrist::keys.blackToMove;
+    }
+    return key;
+}
+
+int ChessGame::computeMaterialScore() const
+{
+    int material = 0;
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        if (board[sq] != Piece::e)
+        {
+            material += pieceMaterial(board[sq]);
+        }
+    }
+    return material;
+}
+
+int ChessGame::computePieceSquareScore() const
+{
+    int pieceSquare = 0;
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        if (board[sq] != Piece::e)
         {
-            return static_cast<Piece>(i + 1); // +1 because 0 is empty square
+            pieceSquare += pieceSquareValue(board[sq], sq);
         }
     }
-    return Piece::e; // Empty square
+    return pieceSquare;
 }
 
 bool ChessGame::isGameOver() const
@@ -329,19 +407,22 @@ bool ChessGame::isGameOver() const
 void ChessGame::parseFEN(const std::string &fen)
 {
     resetBoard(); // Reset the board before parsing a new FEN string
+    stateIndex = 0; // The parsed position becomes the root of the state stack
+    currentState()->capturedPiece = Piece::e;
+    currentState()->enPassantSquare = Square::a1;
 
     std::istringstream ss(fen);
-    std::string board, activeColor, castling, enPassant, halfmove, fullmove;
+    std::string placement, activeColor, castling, enPassant, halfmove, fullmove;
 
     // Parse the 6 fields
-    ss >> board >> activeColor >> castling >> enPassant >> halfmove >> fullmove;
+    ss >> placement >> activeColor >> castling >> enPassant >> halfmove >> fullmove;
 
     // Process board placement
     int row = 7; // Start from the 8th rank
     int col = 0;
 
     int i = 0;
-    for (char c : board)
+    for (char c : placement)
     {
         if (c == '/')
         {
@@ -362,56 +443,47 @@ void ChessGame::parseFEN(const std::string &fen)
             {
             case 'p':
                 piece = Piece::P;
-                pieceBitboards[6] |= (1ULL << (row * 8 + col));
                 break;
             case 'r':
                 piece = Piece::R;
-                pieceBitboards[7] |= (1ULL << (row * 8 + col));
                 break;
             case 'n':
                 piece = Piece::N;
-                pieceBitboards[8] |= (1ULL << (row * 8 + col));
                 break;
             case 'b':
                 piece = Piece::B;
-                pieceBitboards[9] |= (1ULL << (row * 8 + col));
                 break;
             case 'q':
                 piece = Piece::Q;
-                pieceBitboards[10] |= (1ULL << (row * 8 + col));
                 break;
             case 'k':
                 piece = Piece::K;
-                pieceBitboards[11] |= (1ULL << (row * 8 + col));
                 break;
             case 'P':
                 piece = Piece::p;
-                pieceBitboards[0] |= (1ULL << (row * 8 + col));
                 break;
             case 'R':
                 piece = Piece::r;
-                pieceBitboards[1] |= (1ULL << (row * 8 + col));
                 break;
             case 'N':
                 piece = Piece::n;
-                pieceBitboards[2] |= (1ULL << (row * 8 + col));
                 break;
             case 'B':
                 piece = Piece::b;
-                pieceBitboards[3] |= (1ULL << (row * 8 + col));
                 break;
             case 'Q':
                 piece = Piece::q;
-                pieceBitboards[4] |= (1ULL << (row * 8 + col));
                 break;
             case 'K':
                 piece = Piece::k;
-                pieceBitboards[5] |= (1ULL << (row * 8 + col));
                 break;
             default:
                 piece = Piece::e; // Should not happen
             }
-            boardArray[row][col] = piece;
+            if (piece != Piece::e)
+            {
+                putPiece(piece, row * 8 + col);
+            }
             col++;
         }
     }
@@ -426,15 +498,15 @@ void ChessGame::parseFEN(const std::string &fen)
     castlingRights[2] = (castling.find('k') != std::string::npos); // Black kingside
     castlingRights[3] = (castling.find('q') != std::string::npos); // Black queenside
 
-    currentState->castlingRights = 0;
+    currentState()->castlingRights = 0;
     if (castlingRights[0])
-        currentState->castlingRights |= 0b1000; // White kingside
+        currentState()->castlingRights |= 0b1000; // White kingside
     if (castlingRights[1])
-        currentState->castlingRights |= 0b0100; // White queenside
+        currentState()->castlingRights |= 0b0100; // White queenside
     if (castlingRights[2])
-        currentState->castlingRights |= 0b0010; // Black kingside
+        currentState()->castlingRights |= 0b0010; // Black kingside
     if (castlingRights[3])
-        currentState->castlingRights |= 0b0001; // Black queenside
+        currentState()->castlingRights |= 0b0001; // Black queenside
     // Set en passant target square
     if (enPassant == "-")
     {
@@ -443,7 +515,7 @@ void ChessGame::parseFEN(const std::string &fen)
     else
     {
         enPassantTargetSquare = enPassant;
-        currentState->enPassantSquare = static_cast<Square>(ChessGame::parseSquare(enPassant));
+        currentState()->enPassantSquare = static_cast<Square>(ChessGame::parseSquare(enPassant));
     }
 
     halfmoveClock = std::stoi(halfmove);
@@ -459,6 +531,10 @@ void ChessGame::parseFEN(const std::string &fen)
     }
     emptyBitboard = ~occupiedBitboard;
 
+    currentState()->key = computeZobristKey();
+    currentState()->material = computeMaterialScore();
+    currentState()->pieceSquare = computePieceSquareScore();
+
     preworkPosition();
 }
 
@@ -542,25 +618,25 @@ std::string ChessGame::generateFEN()
     fen += whiteTurn ? " w " : " b ";
 
     // Add castling rights
-    if (currentState->castlingRights & 0b1000)
+    if (currentState()->castlingRights & 0b1000)
         fen += "K";
-    if (currentState->castlingRights & 0b0100)
+    if (currentState()->castlingRights & 0b0100)
         fen += "Q";
-    if (currentState->castlingRights & 0b0010)
+    if (currentState()->castlingRights & 0b0010)
         fen += "k";
-    if (currentState->castlingRights & 0b0001)
+    if (currentState()->castlingRights & 0b0001)
         fen += "q";
-    if (!currentState->castlingRights)
+    if (!currentState()->castlingRights)
         fen += "-";
 
     // Add en passant target square
-    if (currentState->enPassantSquare == Square::a1)
+    if (currentState()->enPassantSquare == Square::a1)
     {
         fen += " - ";
     }
     else
     {
-        fen += " " + getSquareName(currentState->enPassantSquare) + " ";
+        fen += " " + getSquareName(currentState()->enPassantSquare) + " ";
     }
     // Add halfmove clock
     fen += std::to_string(halfmoveClock) + " ";
@@ -571,14 +647,17 @@ std::string ChessGame::generateFEN()
 
 void ChessGame::resetBoard()
 {
-    // Reset the board to the initial position
-    for (int row = 0; row < 8; ++row)
+    // Clear the bitboards and the mailbox
+    for (int i = 0; i < 12; ++i)
     {
-        for (int col = 0; col < 8; ++col)
-        {
-            boardArray[row][col] = Piece::e;
-        }
+        pieceBitboards[i] = 0;
+    }
+    for (int sq = 0; sq < 64; ++sq)
+    {
+        board[sq] = Piece::e;
     }
+    occupiedBitboard = 0;
+    emptyBitboard = ~0ULL;
 }
 
 void ChessGame::printBitboards() const
@@ -598,498 +677,323 @@ void ChessGame::printBitboards() const
     std::cout << "------------------------" << std::endl;
 }
 
-std::vector<ChessGame::Move> ChessGame::generateMoves() const
+void ChessGame::generateMoves(MoveList &moves) const
 {
-    std::vector<Move> moves;
-
-    uint64_t whitePieceBitboard = pieceBitboards[0] | pieceBitboards[1] | pieceBitboards[2] | pieceBitboards[3] | pieceBitboards[4] | pieceBitboards[5];
+    generateMoves(moves, GenType::All, true);
+}
 
-    uint64_t blackPieceBitboard = pieceBitboards[6] | pieceBitboards[7] | pieceBitboards[8] | pieceBitboards[9] | pieceBitboards[10] | pieceBitboards[11];
+void ChessGame::generateCaptures(MoveList &moves) const
+{
+    generateMoves(moves, GenType::Captures, true);
+}
 
-    // Generate moves for white pieces
+void ChessGame::generateQuiets(MoveList &moves) const
+{
+    generateMoves(moves, GenType::Quiets, true);
+}
 
-    // Start with pawn moves
+void ChessGame::generatePseudoLegalMoves(MoveList &moves, GenType type) const
+{
+    generateMoves(moves, type, false);
+}
 
-    // Pawn move by 1 square moves
+void ChessGame::generateMoves(MoveList &moves, GenType type, bool legal) const
+{
+    moves.clear();
 
-    // TODO: Pawn promotion moves
+    ensurePositionInfo(); // Pins and checks, unless this node was already queried
+    if (legal)
+    {
+        ensureOpponentAttacks();
+    }
 
-    opponentAttacks = 0; // Reset opponent attacks before generating new ones
+    // Branch on the side to move once; everything below is specialised per colour
+    if (whiteTurn)
+    {
+        generateMovesFor<Color::White>(moves, type, legal);
+    }
+    else
+    {
+        generateMovesFor<Color::Black>(moves, type, legal);
+    }
+}
 
-    generateOpponentAttacks(); // Generate opponent attacks to check for checks
+template <Color Us>
+void ChessGame::generateMovesFor(MoveList &moves, GenType type, bool legal) const
+{
+    uint64_t enemyPieces = piecesOf<Side<Us>::Them>();
+    uint64_t targets = type == GenType::Captures ? enemyPieces : type == GenType::Quiets ? emptyBitboard
+                                                                                         : enemyPieces | emptyBitboard;
 
-    generateKingMoves(moves); // Generate king moves first to check for checks
+    generateKingMoves<Us>(moves, targets, legal); // Generate king moves first to check for checks
 
     if (__builtin_popcountll(checkInfoStruct.checkers) >= 2) // King is in double check -> only king moves
     {
-        return moves;
+        return;
     }
 
-    generatePawnMoves(moves);
-    generateKnightMoves(moves);
-    generateBishopMoves(moves);
-    generateRookMoves(moves);
-    generateQueenMoves(moves);
+    generatePawnMoves<Us>(moves, type, legal);
+    generateKnightMoves<Us>(moves, targets, legal);
+    generateBishopMoves<Us>(moves, targets, legal);
+    generateRookMoves<Us>(moves, targets, legal);
+    generateQueenMoves<Us>(moves, targets, legal);
 
     // Castling moves
-    if (!checkInfoStruct.isInCheck)
+    if (type != GenType::Captures && !checkInfoStruct.isInCheck)
     {
-        generateCastlingMoves(moves);
+        generateCastlingMoves<Us>(moves, legal);
     }
+}
 
-    movesVector = moves; // Store the generated moves in the moves vector
-    return moves;
+int ChessGame::countLegalMoves() const
+{
+    ensurePositionInfo();
+    ensureOpponentAttacks();
+    return whiteTurn ? countMovesFor<Color::White>() : countMovesFor<Color::Black>();
 }
 
-void ChessGame::generatePawnMoves(std::vector<Move> &moves) const
+template <Color Us>
+int ChessGame::countMovesFor() const
 {
-    // Generate pawn moves for the current turn
-    uint64_t pawnBitboard = pieceBitboards[whiteTurn ? 0 : 6]; // Assuming 0 is the index for white pawns and 6 for black pawns
-    int pawnSq;
+    // Mirrors generateMovesFor() with GenType::All, popcounting each target set
+    const uint64_t targets = ~piecesOf<Us>();
+    const uint64_t pinned = pinInfoStruct.pinned_pieces;
+    int kingSq = __builtin_ctzll(pieceBitboards[Side<Us>::King]);
 
-    while (pawnBitboard)
+    uint64_t kingTargets = kingPseudoAttacks[kingSq] & targets & ~opponentAttacks;
+    if (checkInfoStruct.isInCheck)
     {
-        pawnSq = pop_lsb(pawnBitboard); // Get the least significant bit (first pawn)
+        kingTargets &= checkInfoStruct.checkers | ~checkInfoStruct.checkBlockSquares;
+    }
+    int count = __builtin_popcountll(kingTargets);
 
-        // Forward move
-        int forwardSq = pawnSq + (whiteTurn ? 8 : -8);
-        if ((whiteTurn && forwardSq < 64 && (emptyBitboard & (1ULL << forwardSq))) ||
-            (!whiteTurn && forwardSq >= 0 && (emptyBitboard & (1ULL << forwardSq))))
-        {
-            if ((pinInfoStruct.pinned_pieces & (1ULL << pawnSq)) && checkInfoStruct.isInCheck)
-            {
-                ; // Do nothing if in check and pawn is pinned
-            }
-            else if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq))
-            {
-                // If the pawn is pinned, it can only move forward if the pin ray allows it
-                if ((pinInfoStruct.pin_rays[pawnSq] & (1ULL << forwardSq)))
-                {
-                    if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                    {
-                        for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                        {
-                            Move move;
-                            move.isCapture = false;
-                            move.isPromotion = true; // Set promotion flag
-                            move.from = static_cast<Square>(pawnSq);
-                            move.to = static_cast<Square>(forwardSq);
-                            move.promotionPiece = promotionPiece; // Set the promotion piece
-                            moves.push_back(move);
-                        }
-                    }
-                    else
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(forwardSq);
-                        move.isCapture = false;
-                        moves.push_back(move);
-                    }
-                }
-            }
-            else if (checkInfoStruct.isInCheck)
-            {
-                // If the king is in check, only allow moves that block the check or capture the checking piece
-                if ((checkInfoStruct.checkers & (1ULL << forwardSq)) || (checkInfoStruct.checkBlockSquares & (1ULL << forwardSq)))
-                {
-                    if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                    {
-                        for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                        {
-                            Move move;
-                            move.from = static_cast<Square>(pawnSq);
-                            move.to = static_cast<Square>(forwardSq);
-                            move.isCapture = false;
-                            move.isPromotion = true;              // Set promotion flag
-                            move.promotionPiece = promotionPiece; // Set the promotion piece
-                            moves.push_back(move);
-                        }
-                    }
-                    else
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(forwardSq);
-                        move.isCapture = false;
-                        moves.push_back(move);
-                    }
-                }
-            }
-            else
-            {
-                if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                {
-                    for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(forwardSq);
-                        move.isCapture = false;
-                        move.isPromotion = true;              // Set promotion flag
-                        move.promotionPiece = promotionPiece; // Set the promotion piece
-                        moves.push_back(move);
-                    }
-                }
-                else
-                {
-                    Move move;
-                    move.from = static_cast<Square>(pawnSq);
-                    move.to = static_cast<Square>(forwardSq);
-                    move.isCapture = false;
-                    moves.push_back(move);
-                }
-            }
+    if (__builtin_popcountll(checkInfoStruct.checkers) >= 2) // Double check: only the king moves
+    {
+        return count;
+    }
+    const uint64_t evasions = checkInfoStruct.isInCheck ? checkInfoStruct.checkers | checkInfoStruct.checkBlockSquares : ~0ULL;
 
-            // Double forward move
-            int doubleForwardSq = forwardSq + (whiteTurn ? 8 : -8);
-            if ((whiteTurn && doubleForwardSq < 64 && (emptyBitboard & (1ULL << doubleForwardSq)) &&
-                 (pawnSq / 8 == (whiteTurn ? 1 : 6))) ||
-                (!whiteTurn && doubleForwardSq >= 0 && (emptyBitboard & (1ULL << doubleForwardSq)) &&
-                 (pawnSq / 8 == (whiteTurn ? 1 : 6))))
-            {
-                if ((pinInfoStruct.pinned_pieces & (1ULL << pawnSq)) && checkInfoStruct.isInCheck)
-                {
-                    ; // Do nothing if in check and pawn is pinned
-                }
-                else if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq))
-                {
-                    // If the pawn is pinned, it can only move forward if the pin ray allows it
-                    if ((pinInfoStruct.pin_rays[pawnSq] & (1ULL << doubleForwardSq)))
-                    {
-                        Move doubleMove;
-                        doubleMove.from = static_cast<Square>(pawnSq);
-                        doubleMove.to = static_cast<Square>(doubleForwardSq);
-                        doubleMove.isCapture = false;
-                        moves.push_back(doubleMove);
-                    }
-                }
-                else if (checkInfoStruct.isInCheck)
-                {
-                    // If the king is in check, only allow moves that block the check or capture the checking piece
-                    if ((checkInfoStruct.checkers & (1ULL << doubleForwardSq)) || (checkInfoStruct.checkBlockSquares & (1ULL << doubleForwardSq)))
-                    {
-                        Move doubleMove;
-                        doubleMove.from = static_cast<Square>(pawnSq);
-                        doubleMove.to = static_cast<Square>(doubleForwardSq);
-                        doubleMove.isCapture = false;
-                        moves.push_back(doubleMove);
-                    }
-                }
-                else
-                {
-                    Move doubleMove;
-                    doubleMove.from = static_cast<Square>(pawnSq);
-                    doubleMove.to = static_cast<Square>(doubleForwardSq);
-                    doubleMove.isCapture = false;
-                    moves.push_back(doubleMove);
-                }
-            }
+    uint64_t knights = pieceBitboards[Side<Us>::Knight] & ~pinned;
+    while (knights)
+    {
+        count += __builtin_popcountll(knightPseudoAttacks[pop_lsb(knights)] & targets & evasions);
+    }
+
+    uint64_t queens = pieceBitboards[Side<Us>::Queen];
+    uint64_t diagonal = pieceBitboards[Side<Us>::Bishop] | queens;
+    while (diagonal)
+    {
+        int sq = pop_lsb(diagonal);
+        uint64_t attacks = getBishopAttacks(occupiedBitboard, sq) & targets & evasions;
+        count += __builtin_popcountll((pinned & (1ULL << sq)) ? attacks & pinLine(sq) : attacks);
+    }
+    uint64_t orthogonal = pieceBitboards[Side<Us>::Rook] | queens;
+    while (orthogonal)
+    {
+        int sq = pop_lsb(orthogonal);
+        uint64_t attacks = getRookAttacks(occupiedBitboard, sq) & targets & evasions;
+        count += __builtin_popcountll((pinned & (1ULL << sq)) ? attacks & pinLine(sq) : attacks);
+    }
+
+    uint64_t pawns = pieceBitboards[Side<Us>::Pawn];
+    count += countPawnMovesFrom<Us>(pawns & ~pinned, evasions);
+    if (!checkInfoStruct.isInCheck)
+    {
+        uint64_t pinnedPawns = pawns & pinned; // A pinned pawn can never resolve a check
+        while (pinnedPawns)
+        {
+            int pawnSq = pop_lsb(pinnedPawns);
+            count += countPawnMovesFrom<Us>(1ULL << pawnSq, pinLine(pawnSq));
         }
+        count += __builtin_popcountll(castlingSides<Us>(true));
+    }
+    count += __builtin_popcountll(enPassantCapturers<Us>(true));
+    return count;
+}
+
+template <Color Us>
+int ChessGame::countPawnMovesFrom(uint64_t pawns, uint64_t allowed) const
+{
+    // Same sets as generatePawnMovesFrom(); every promotion counts four times
+    constexpr uint64_t promotionRank = rankConst[Us == Color::White ? 7 : 0];
+    constexpr uint64_t doublePushRank = rankConst[Us == Color::White ? 2 : 5];
+    const uint64_t enemies = piecesOf<Side<Us>::Them>();
+
+    uint64_t singlePushes = shift<Side<Us>::Up>(pawns) & emptyBitboard;
+    uint64_t doublePushes = shift<Side<Us>::Up>(singlePushes & doublePushRank) & emptyBitboard & allowed;
+    singlePushes &= allowed;
+    uint64_t leftCaptures = shift<Side<Us>::UpLeft>(pawns & ~fileConst[0]) & enemies & allowed;
+    uint64_t rightCaptures = shift<Side<Us>::UpRight>(pawns & ~fileConst[7]) & enemies & allowed;
+
+    int count = __builtin_popcountll(singlePushes & ~promotionRank) + __builtin_popcountll(doublePushes) +
+                __builtin_popcountll(leftCaptures & ~promotionRank) + __builtin_popcountll(rightCaptures & ~promotionRank);
+    count += 4 * (__builtin_popcountll(singlePushes & promotionRank) + __builtin_popcountll(leftCaptures & promotionRank) +
+                  __builtin_popcountll(rightCaptures & promotionRank));
+    return count;
+}
+
+template <Color Us>
+void ChessGame::generatePawnMoves(MoveList &moves, GenType type, bool legal) const
+{
+    // Pawns are generated set-wise: every pawn is shifted at once and the
+    // resulting target sets are masked by emptiness, enemies, check and pins
+    uint64_t pawns = pieceBitboards[Side<Us>::Pawn];
+    uint64_t pinned = legal ? pawns & pinInfoStruct.pinned_pieces : 0; // Pseudo-legal pins are left to isLegal()
 
-        // Capture moves
-        int leftCaptureSq = pawnSq + (whiteTurn ? 7 : -9); // Left capture square
-        if (pawnSq % 8 != 0 && ((whiteTurn && leftCaptureSq < 64 && (1ULL << leftCaptureSq) & blackPieces) ||
-                                (!whiteTurn && leftCaptureSq >= 0 && (1ULL << leftCaptureSq) & whitePieces)))
+    if (checkInfoStruct.isInCheck)
+    {
+        // A pinned pawn can never resolve a check; the others must capture the checker or block
+        generatePawnMovesFrom<Us>(moves, pawns & ~pinned, checkInfoStruct.checkers | checkInfoStruct.checkBlockSquares, type);
+    }
+    else
+    {
+        generatePawnMovesFrom<Us>(moves, pawns & ~pinned, ~0ULL, type);
+        while (pinned)
         {
-            if ((pinInfoStruct.pinned_pieces & (1ULL << pawnSq)) && checkInfoStruct.isInCheck)
-            {
-                ; // Do nothing if in check and pawn is pinned
-            }
-            else if (checkInfoStruct.isInCheck)
-            {
-                // If the king is in check, only allow moves that block the check or capture the checking piece
-                // And we also make sure that if the pawn is pinned, it can only capture if the pin ray allows it
+            int pawnSq = pop_lsb(pinned); // At most a handful, each restricted to its own pin line
+            generatePawnMovesFrom<Us>(moves, 1ULL << pawnSq, pinLine(pawnSq), type);
+        }
+    }
 
-                if ((pinInfoStruct.pin_rays[pawnSq] & (1ULL << leftCaptureSq)) || (checkInfoStruct.checkers & (1ULL << leftCaptureSq)) || (checkInfoStruct.checkBlockSquares & (1ULL << leftCaptureSq)))
-                {
-                    if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                    {
-                        for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                        {
-                            Move move;
-                            move.isCapture = true;
-                            move.isPromotion = true; // Set promotion flag
-                            move.from = static_cast<Square>(pawnSq);
-                            move.to = static_cast<Square>(leftCaptureSq);
-                            move.promotionPiece = promotionPiece; // Set the promotion piece
-                            moves.push_back(move);
-                        }
-                    }
-                    else
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(leftCaptureSq);
-                        move.isCapture = true;
-                        moves.push_back(move);
-                    }
-                }
-            }
-            else if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq))
-            {
-                // If the pawn is pinned, it can only capture if the pin ray allows it
-                if ((pinInfoStruct.pin_rays[pawnSq] & (1ULL << leftCaptureSq)))
-                {
-                    if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                    {
-                        for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                        {
-                            Move move;
-                            move.isCapture = true;
-                            move.isPromotion = true; // Set promotion flag
-                            move.from = static_cast<Square>(pawnSq);
-                            move.to = static_cast<Square>(leftCaptureSq);
-                            move.promotionPiece = promotionPiece; // Set the promotion piece
-                            moves.push_back(move);
-                        }
-                    }
-                    else
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(leftCaptureSq);
-                        move.isCapture = true;
-                        moves.push_back(move);
-                    }
-                }
-            }
-            else
-            {
-                if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                {
-                    for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                    {
-                        Move move;
-                        move.isCapture = true;
-                        move.isPromotion = true; // Set promotion flag
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(leftCaptureSq);
-                        move.promotionPiece = promotionPiece; // Set the promotion piece
-                        moves.push_back(move);
-                    }
-                }
-                else
-                {
-                    Move move;
-                    move.from = static_cast<Square>(pawnSq);
-                    move.to = static_cast<Square>(leftCaptureSq);
-                    move.isCapture = true;
-                    moves.push_back(move);
-                }
-            }
+    // En passant capture
+    if (type == GenType::Quiets)
+    {
+        return;
+    }
+    uint64_t capturers = enPassantCapturers<Us>(legal);
+    while (capturers)
+    {
+        int pawnSq = pop_lsb(capturers);
+        moves.push_back(Move(static_cast<Square>(pawnSq), currentState()->enPassantSquare, Move::EnPassant));
+    }
+}
+
+template <Color Us>
+uint64_t ChessGame::enPassantCapturers(bool legal) const
+{
+    if (currentState()->enPassantSquare == Square::a1)
+    {
+        return 0;
+    }
+    int enPassantSq = static_cast<int>(currentState()->enPassantSquare);
+    uint64_t enPassantBB = 1ULL << enPassantSq;
+    if (!(enPassantBB & rankConst[Us == Color::White ? 5 : 2]))
+    {
+        return 0;
+    }
+    int targetPawnSq = enPassantSq - Side<Us>::Up; // The square of the pawn that is being captured en passant
+
+    // Our pawns that attack the en passant square: one file to either side, one rank behind it
+    uint64_t attackers = (shift<-Side<Us>::UpLeft>(enPassantBB & ~fileConst[7]) | shift<-Side<Us>::UpRight>(enPassantBB & ~fileConst[0])) &
+                         pieceBitboards[Side<Us>::Pawn];
+    uint64_t capturers = 0;
+    while (attackers)
+    {
+        int pawnSq = pop_lsb(attackers);
+        bool isPinned = pinInfoStruct.pinned_pieces & (1ULL << pawnSq);
+        bool valid;
+        if (checkInfoStruct.isInCheck)
+        {
+            // Only legal if it removes the checking pawn or blocks the check on the en passant square
+            valid = (checkInfoStruct.checkers & (1ULL << targetPawnSq)) || (checkInfoStruct.checkBlockSquares & enPassantBB);
+            valid = valid && (!legal || (!isPinned && enPassantIsLegal<Us>(pawnSq, enPassantSq)));
         }
-        int rightCaptureSq = pawnSq + (whiteTurn ? 9 : -7);
-        if (pawnSq % 8 != 7 && ((whiteTurn && rightCaptureSq < 64 && (1ULL << rightCaptureSq) & blackPieces) ||
-                                (!whiteTurn && rightCaptureSq >= 0 && (1ULL << rightCaptureSq) & whitePieces)))
+        else if (!legal)
         {
-            if ((pinInfoStruct.pinned_pieces & (1ULL << pawnSq)) && checkInfoStruct.isInCheck)
-            {
-                ; // Do nothing if in check and pawn is pinned
-            }
-            else if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq))
-            {
-                // If the pawn is pinned, it can only capture if the pin ray allows it
-                if ((pinInfoStruct.pin_rays[pawnSq] & (1ULL << rightCaptureSq)))
-                {
-                    if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                    {
-                        for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                        {
-                            Move move;
-                            move.isCapture = true;
-                            move.isPromotion = true; // Set promotion flag
-                            move.from = static_cast<Square>(pawnSq);
-                            move.to = static_cast<Square>(rightCaptureSq);
-                            move.promotionPiece = promotionPiece; // Set the promotion piece
-                            moves.push_back(move);
-                        }
-                    }
-                    else
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(rightCaptureSq);
-                        move.isCapture = true;
-                        moves.push_back(move);
-                    }
-                }
-            }
-            else if (checkInfoStruct.isInCheck)
-            {
-                // If the king is in check, only allow moves that block the check or capture the checking piece
-                if ((checkInfoStruct.checkers & (1ULL << rightCaptureSq)) || (checkInfoStruct.checkBlockSquares & (1ULL << rightCaptureSq)))
-                {
-                    if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                    {
-                        for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                        {
-                            Move move;
-                            move.isCapture = true;
-                            move.isPromotion = true; // Set promotion flag
-                            move.from = static_cast<Square>(pawnSq);
-                            move.to = static_cast<Square>(rightCaptureSq);
-                            move.promotionPiece = promotionPiece; // Set the promotion piece
-                            moves.push_back(move);
-                        }
-                    }
-                    else
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(rightCaptureSq);
-                        move.isCapture = true;
-                        moves.push_back(move);
-                    }
-                }
-            }
-            else
-            {
-                if ((forwardSq >= 0 && forwardSq <= 7) || (forwardSq >= 56 && forwardSq <= 63))
-                {
-                    for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
-                    {
-                        Move move;
-                        move.isCapture = true;
-                        move.isPromotion = true; // Set promotion flag
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(rightCaptureSq);
-                        move.promotionPiece = promotionPiece; // Set the promotion piece
-                        moves.push_back(move);
-                    }
-                }
-                else
-                {
-                    Move move;
-                    move.from = static_cast<Square>(pawnSq);
-                    move.to = static_cast<Square>(rightCaptureSq);
-                    move.isCapture = true;
-                    moves.push_back(move);
-                }
-            }
+            valid = true; // Pins and the discovered check along the rank are left to isLegal()
+        }
+        else if (isPinned)
+        {
+            valid = pinLine(pawnSq) & enPassantBB; // If the pawn is pinned, it can only capture if the pin ray allows it
+        }
+        else
+        {
+            valid = enPassantIsLegal<Us>(pawnSq, enPassantSq); // Both pawns leaving the rank can expose the king
+        }
+        if (valid)
+        {
+            capturers |= 1ULL << pawnSq;
         }
+    }
+    return capturers;
+}
+
+template <Color Us>
+void ChessGame::generatePawnMovesFrom(MoveList &moves, uint64_t pawns, uint64_t allowed, GenType type) const
+{
+    constexpr int up = Side<Us>::Up;
+    constexpr int upLeft = Side<Us>::UpLeft;
+    constexpr int upRight = Side<Us>::UpRight;
+    constexpr uint64_t promotionRank = rankConst[Us == Color::White ? 7 : 0];
+    constexpr uint64_t doublePushRank = rankConst[Us == Color::White ? 2 : 5]; // Where a single push from the start rank lands
+    const uint64_t enemies = piecesOf<Side<Us>::Them>();
+
+    uint64_t singlePushes = shift<up>(pawns) & emptyBitboard;
+    uint64_t doublePushes = shift<up>(singlePushes & doublePushRank) & emptyBitboard & allowed;
+    singlePushes &= allowed;
+    uint64_t leftCaptures = shift<upLeft>(pawns & ~fileConst[0]) & enemies & allowed;
+    uint64_t rightCaptures = shift<upRight>(pawns & ~fileConst[7]) & enemies & allowed;
+
+    if (type != GenType::Quiets)
+    {
+        addPawnMoves(moves, leftCaptures & ~promotionRank, upLeft, Move::Capture);
+        addPawnMoves(moves, rightCaptures & ~promotionRank, upRight, Move::Capture);
+        addPawnPromotions(moves, singlePushes & promotionRank, up, false);
+        addPawnPromotions(moves, leftCaptures & promotionRank, upLeft, true);
+        addPawnPromotions(moves, rightCaptures & promotionRank, upRight, true);
+    }
+    if (type != GenType::Captures)
+    {
+        addPawnMoves(moves, singlePushes & ~promotionRank, up, Move::Quiet);
+        addPawnMoves(moves, doublePushes, 2 * up, Move::DoublePawnPush);
+    }
+}
+
+void ChessGame::addPawnMoves(MoveList &moves, uint64_t targets, int offset, uint8_t flags) const
+{
+    while (targets)
+    {
+        int toSq = pop_lsb(targets);
+        moves.push_back(Move(static_cast<Square>(toSq - offset), static_cast<Square>(toSq), flags));
+    }
+}
 
-        // En passant capture
-        if (currentState->enPassantSquare != Square::a1)
+void ChessGame::addPawnPromotions(MoveList &moves, uint64_t targets, int offset, bool capture) const
+{
+    while (targets)
+    {
+        int toSq = pop_lsb(targets);
+        for (Piece promotionPiece : {Piece::Q, Piece::R, Piece::B, Piece::N})
         {
-            int enPassantSq = static_cast<int>(currentState->enPassantSquare);
-            int targetPawnSq = enPassantSq + (whiteTurn ? -8 : 8); // The square of the pawn that is being captured en passant
-            if (pawnSq % 8 != 0 && leftCaptureSq == enPassantSq && ((whiteTurn && enPassantSq >= 40 && enPassantSq <= 47) || (!whiteTurn && enPassantSq >= 16 && enPassantSq <= 23)))
-            {
-                if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq) && checkInfoStruct.isInCheck)
-                {
-                    ; // Do nothing if in check and pawn is pinned
-                }
-                else if (checkInfoStruct.isInCheck)
-                {
-                    // If the king is in check, only allow moves that block the check or capture the checking piece
-                    // And we also make sure that if the pawn is pinned, it can only capture if the pin ray allows it
-
-                    if ((pinInfoStruct.pin_rays[pawnSq] & (1ULL << leftCaptureSq)) || (checkInfoStruct.checkers & (1ULL << targetPawnSq)) || (checkInfoStruct.checkBlockSquares & (1ULL << leftCaptureSq)))
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(leftCaptureSq);
-                        move.isCapture = true;
-                        move.isEnPassant = true;
-                        moves.push_back(move);
-                    }
-                }
-                else if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq) && (pinInfoStruct.pin_rays[pawnSq] & (1ULL << leftCaptureSq)))
-                {
-                    // If the pawn is pinned, it can only capture if the pin ray allows it
-                    Move move;
-                    move.from = static_cast<Square>(pawnSq);
-                    move.to = static_cast<Square>(leftCaptureSq);
-                    move.isCapture = true;
-                    move.isEnPassant = true;
-                    moves.push_back(move);
-                }
-                else
-                {
-                    if (enPassantIsLegal(pawnSq, enPassantSq))
-                    {
-                        // If the en passant move is legal, add it
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(enPassantSq);
-                        move.isCapture = true;
-                        move.isEnPassant = true;
-                        moves.push_back(move);
-                    }
-                }
-            }
-            if (pawnSq % 8 != 7 && rightCaptureSq == enPassantSq && ((whiteTurn && enPassantSq >= 40 && enPassantSq <= 47) || (!whiteTurn && enPassantSq >= 16 && enPassantSq <= 23)))
-            {
-                if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq) && checkInfoStruct.isInCheck)
-                {
-                    ; // Do nothing if in check and pawn is pinned
-                }
-                else if (checkInfoStruct.isInCheck)
-                {
-                    // If the king is in check, only allow moves that block the check or capture the checking piece
-                    // And we also make sure that if the pawn is pinned, it can only capture if the pin ray allows it
-
-                    if ((pinInfoStruct.pin_rays[pawnSq] & (1ULL << rightCaptureSq)) || (checkInfoStruct.checkers & (1ULL << targetPawnSq)) || (checkInfoStruct.checkBlockSquares & (1ULL << rightCaptureSq)))
-                    {
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(rightCaptureSq);
-                        move.isCapture = true;
-                        move.isEnPassant = true;
-                        moves.push_back(move);
-                    }
-                }
-                else if (pinInfoStruct.pinned_pieces & (1ULL << pawnSq) && (pinInfoStruct.pin_rays[pawnSq] & (1ULL << rightCaptureSq)))
-                {
-                    // If the pawn is pinned, it can only capture if the pin ray allows it
-                    Move move;
-                    move.from = static_cast<Square>(pawnSq);
-                    move.to = static_cast<Square>(rightCaptureSq);
-                    move.isCapture = true;
-                    move.isEnPassant = true;
-                    moves.push_back(move);
-                }
-                else
-                {
-                    if (enPassantIsLegal(pawnSq, enPassantSq))
-                    {
-                        // If the en passant move is legal, add it
-                        Move move;
-                        move.from = static_cast<Square>(pawnSq);
-                        move.to = static_cast<Square>(enPassantSq);
-                        move.isCapture = true;
-                        move.isEnPassant = true;
-                        moves.push_back(move);
-                    }
-                }
-            }
+            moves.push_back(Move(static_cast<Square>(toSq - offset), static_cast<Square>(toSq), Move::promotionFlags(promotionPiece, capture)));
         }
     }
 }
 
+template <Color Us>
 bool ChessGame::enPassantIsLegal(int pawnSq, int enPassantSq) const
 {
     // Check if the en passant move is legal
 
     // Remove the target pawn from its square and then check if our pawn is pinned
-    int targetPawnSq = enPassantSq + (whiteTurn ? -8 : 8); // The square of the pawn that is being captured en passant
+    int targetPawnSq = enPassantSq - Side<Us>::Up; // The square of the pawn that is being captured en passant
     uint64_t targetPawnBB = (1ULL << targetPawnSq);
-    uint64_t enemyPiecesCopy = whiteTurn ? blackPieces : whitePieces;
+    uint64_t enemyPiecesCopy = piecesOf<Side<Us>::Them>();
     enemyPiecesCopy &= ~targetPawnBB; // Remove the target pawn from the enemy pieces
 
     // Recalculate pin information
-    PinInfo tempPinInfo = calculatePins(enemyPiecesCopy, whiteTurn);
+    PinInfo tempPinInfo = calculatePins<Us>(enemyPiecesCopy);
 
     bool isPinned = (tempPinInfo.pinned_pieces & (1ULL << pawnSq)) != 0;
 
     return !isPinned;
 }
 
-void ChessGame::generateKnightMoves(std::vector<Move> &moves) const
+template <Color Us>
+void ChessGame::generateKnightMoves(MoveList &moves, uint64_t targets, bool legal) const
 {
-    // Generate knight moves for the current turn
-    uint64_t knightBitboard = pieceBitboards[whiteTurn ? 2 : 8] & ~pinInfoStruct.pinned_pieces; // Assuming 2 is the index for white knights and 8 for black knights
+    // Generate knight moves for the current turn; a pinned knight can never move
+    uint64_t knightBitboard = pieceBitboards[Side<Us>::Knight] & ~(legal ? pinInfoStruct.pinned_pieces : 0);
     int knightSq;
 
     while (knightBitboard)
@@ -1097,7 +1001,7 @@ void ChessGame::generateKnightMoves(std::vector<Move> &moves) const
         knightSq = pop_lsb(knightBitboard); // Get the least significant bit (first knight)
 
         // Get all possible attacks for this knight
-        uint64_t attacks = knightPseudoAttacks[knightSq] & ~(whiteTurn ? whitePieces : blackPieces);
+        uint64_t attacks = knightPseudoAttacks[knightSq] & targets;
 
         if (checkInfoStruct.isInCheck)
         {
@@ -1109,19 +1013,16 @@ void ChessGame::generateKnightMoves(std::vector<Move> &moves) const
         {
             int destSq = pop_lsb(attacks); // Get the least significant bit (first attack)
 
-            Move move;
-            move.from = static_cast<Square>(knightSq);
-            move.to = static_cast<Square>(destSq);
-            move.isCapture = ((whiteTurn ? blackPieces : whitePieces) & (1ULL << destSq)) != 0; // Check if it's a capture
-            moves.push_back(move);
+            moves.push_back(Move(static_cast<Square>(knightSq), static_cast<Square>(destSq), (piecesOf<Side<Us>::Them>() & (1ULL << destSq)) ? Move::Capture : Move::Quiet));
         }
     }
 }
 
-void ChessGame::generateRookMoves(std::vector<Move> &moves) const
+template <Color Us>
+void ChessGame::generateRookMoves(MoveList &moves, uint64_t targets, bool legal) const
 {
     // Generate rook moves for the current turn
-    uint64_t rookBitboard = pieceBitboards[whiteTurn ? 1 : 7]; // Assuming 1 is the index for rooks
+    uint64_t rookBitboard = pieceBitboards[Side<Us>::Rook];
     int rookSq;
 
     while (rookBitboard)
@@ -1130,12 +1031,12 @@ void ChessGame::generateRookMoves(std::vector<Move> &moves) const
         uint64_t from_bb = (1ULL << rookSq); // Bitboard for the current rook square
 
         // Get all possible attacks for this rook
-        uint64_t attacks = getRookAttacks(occupiedBitboard, rookSq) & ~(whiteTurn ? whitePieces : blackPieces);
+        uint64_t attacks = getRookAttacks(occupiedBitboard, rookSq) & targets;
 
-        if (pinInfoStruct.pinned_pieces & from_bb)
+        if (legal && (pinInfoStruct.pinned_pieces & from_bb))
         {
             // If the rook is pinned, only allow moves along the pin ray
-            attacks &= pinInfoStruct.pin_rays[rookSq];
+            attacks &= pinLine(rookSq);
         }
 
         if (checkInfoStruct.isInCheck)
@@ -1148,19 +1049,16 @@ void ChessGame::generateRookMoves(std::vector<Move> &moves) const
         {
             int destSq = pop_lsb(attacks); // Get the least significant bit (first attack)
 
-            Move move;
-            move.from = static_cast<Square>(rookSq);
-            move.to = static_cast<Square>(destSq);
-            move.isCapture = ((whiteTurn ? blackPieces : whitePieces) & (1ULL << destSq)) != 0; // Check if it's a capture
-            moves.push_back(move);
+            moves.push_back(Move(static_cast<Square>(rookSq), static_cast<Square>(destSq), (piecesOf<Side<Us>::Them>() & (1ULL << destSq)) ? Move::Capture : Move::Quiet));
         }
     }
 }
 
-void ChessGame::generateBishopMoves(std::vector<Move> &moves) const
+template <Color Us>
+void ChessGame::generateBishopMoves(MoveList &moves, uint64_t targets, bool legal) const
 {
     // Generate bishop moves for the current turn
-    uint64_t bishopBitboard = pieceBitboards[whiteTurn ? 3 : 9]; // Assuming 3 is the index for bishops
+    uint64_t bishopBitboard = pieceBitboards[Side<Us>::Bishop];
     int bishopSq;
 
     while (bishopBitboard)
@@ -1168,13 +1066,13 @@ void ChessGame::generateBishopMoves(std::vector<Move> &moves) const
         bishopSq = pop_lsb(bishopBitboard); // Get the least significant bit (first bishop)
 
         // Get all possible attacks for this bishop
-        uint64_t attacks = getBishopAttacks(occupiedBitboard, bishopSq) & ~(whiteTurn ? whitePieces : blackPieces);
+        uint64_t attacks = getBishopAttacks(occupiedBitboard, bishopSq) & targets;
 
         uint64_t from_bb = (1ULL << bishopSq); // Bitboard for the current bishop square
-        if (pinInfoStruct.pinned_pieces & from_bb)
+        if (legal && (pinInfoStruct.pinned_pieces & from_bb))
         {
             // If the bishop is pinned, only allow moves along the pin ray
-            attacks &= pinInfoStruct.pin_rays[bishopSq];
+            attacks &= pinLine(bishopSq);
         }
 
         if (checkInfoStruct.isInCheck)
@@ -1187,19 +1085,16 @@ void ChessGame::generateBishopMoves(std::vector<Move> &moves) const
         {
             int destSq = pop_lsb(attacks); // Get the least significant bit (first attack)
 
-            Move move;
-            move.from = static_cast<Square>(bishopSq);
-            move.to = static_cast<Square>(destSq);
-            move.isCapture = ((whiteTurn ? blackPieces : whitePieces) & (1ULL << destSq)) != 0; // Check if it's a capture
-            moves.push_back(move);
+            moves.push_back(Move(static_cast<Square>(bishopSq), static_cast<Square>(destSq), (piecesOf<Side<Us>::Them>() & (1ULL << destSq)) ? Move::Capture : Move::Quiet));
         }
     }
 }
 
-void ChessGame::generateQueenMoves(std::vector<Move> &moves) const
+template <Color Us>
+void ChessGame::generateQueenMoves(MoveList &moves, uint64_t targets, bool legal) const
 {
     // Generate queen moves for the current turn
-    uint64_t queenBitboard = pieceBitboards[whiteTurn ? 4 : 10]; // Assuming 4 is the index for queens
+    uint64_t queenBitboard = pieceBitboards[Side<Us>::Queen];
     int queenSq;
 
     while (queenBitboard)
@@ -1207,13 +1102,13 @@ void ChessGame::generateQueenMoves(std::vector<Move> &moves) const
         queenSq = pop_lsb(queenBitboard); // Get the least significant bit (first queen)
 
         // Get all possible attacks for this queen
-        uint64_t attacks = getQueenAttacks(occupiedBitboard, queenSq) & ~(whiteTurn ? whitePieces : blackPieces);
+        uint64_t attacks = getQueenAttacks(occupiedBitboard, queenSq) & targets;
 
         uint64_t from_bb = (1ULL << queenSq); // Bitboard for the current queen square
-        if (pinInfoStruct.pinned_pieces & from_bb)
+        if (legal && (pinInfoStruct.pinned_pieces & from_bb))
         {
             // If the queen is pinned, only allow moves along the pin ray
-            attacks &= pinInfoStruct.pin_rays[queenSq];
+            attacks &= pinLine(queenSq);
         }
 
         if (checkInfoStruct.isInCheck)
@@ -1226,19 +1121,16 @@ void ChessGame::generateQueenMoves(std::vector<Move> &moves) const
         {
             int destSq = pop_lsb(attacks); // Get the least significant bit (first attack)
 
-            Move move;
-            move.from = static_cast<Square>(queenSq);
-            move.to = static_cast<Square>(destSq);
-            move.isCapture = ((whiteTurn ? blackPieces : whitePieces) & (1ULL << destSq)) != 0; // Check if it's a capture
-            moves.push_back(move);
+            moves.push_back(Move(static_cast<Square>(queenSq), static_cast<Square>(destSq), (piecesOf<Side<Us>::Them>() & (1ULL << destSq)) ? Move::Capture : Move::Quiet));
         }
     }
 }
 
-void ChessGame::generateKingMoves(std::vector<Move> &moves) const // Only legal moves
+template <Color Us>
+void ChessGame::generateKingMoves(MoveList &moves, uint64_t targets, bool legal) const
 {
     // Generate king moves for the current turn
-    uint64_t kingBitboard = pieceBitboards[whiteTurn ? 5 : 11]; // Assuming 5 is the index for kings
+    uint64_t kingBitboard = pieceBitboards[Side<Us>::King];
     int kingSq;
 
     while (kingBitboard)
@@ -1246,9 +1138,9 @@ void ChessGame::generateKingMoves(std::vector<Move> &moves) const // Only legal
         kingSq = pop_lsb(kingBitboard); // Get the least significant bit (first king)
 
         // Get all possible attacks for this king
-        uint64_t attacks = kingPseudoAttacks[kingSq] & ~(whiteTurn ? whitePieces : blackPieces);
+        uint64_t attacks = kingPseudoAttacks[kingSq] & targets;
 
-        if (checkInfoStruct.isInCheck)
+        if (legal && checkInfoStruct.isInCheck) // Pseudo-legal king moves are filtered by isLegal()
         {
             // If the king is in check, only allow moves that capture the checking piece
             attacks &= (checkInfoStruct.checkers | ~checkInfoStruct.checkBlockSquares) & ~opponentAttacks; // This is annoying I need a way to check if the piece that the king wants to attack is defended
@@ -1264,93 +1156,65 @@ void ChessGame::generateKingMoves(std::vector<Move> &moves) const // Only legal
             int destSq = pop_lsb(attacks); // Get the least significant bit (first attack)
 
             // Check if the destination square is attacked by opponent pieces
-            if (!(opponentAttacks & (1ULL << destSq)))
+            if (!legal || !(opponentAttacks & (1ULL << destSq)))
             {
-                Move move;
-                move.from = static_cast<Square>(kingSq);
-                move.to = static_cast<Square>(destSq);
-                move.isCapture = ((whiteTurn ? blackPieces : whitePieces) & (1ULL << destSq)) != 0; // Check if it's a capture
-                moves.push_back(move);
+                moves.push_back(Move(static_cast<Square>(kingSq), static_cast<Square>(destSq), (piecesOf<Side<Us>::Them>() & (1ULL << destSq)) ? Move::Capture : Move::Quiet));
             }
         }
     }
 }
 
-void ChessGame::generateCastlingMoves(std::vector<Move> &moves) const
+template <Color Us>
+void ChessGame::generateCastlingMoves(MoveList &moves, bool legal) const
 {
-    // Generate castling moves for the current turn
-    if (whiteTurn)
+    constexpr int kingSq = static_cast<int>(Square::e1) + (Us == Color::White ? 0 : 56);
+    int sides = castlingSides<Us>(legal);
+    if (sides & 1)
     {
-        if (currentState->castlingRights & 0b1000 && (pieceBitboards[5] & (1ULL << static_cast<int>(Square::e1))) && (pieceBitboards[1] & (1ULL << static_cast<int>(Square::h1)))) // White kingside castling
-        {
-            if (!((occupiedBitboard & (1ULL << static_cast<int>(Square::f1))) || (occupiedBitboard & (1ULL << static_cast<int>(Square::g1)))))
-            {
-                // Check if the squares f1 and g1 are will not put the king in check
-                // or pass through a check
-                if (!(opponentAttacks & (1ULL << static_cast<int>(Square::f1))) && !(opponentAttacks & (1ULL << static_cast<int>(Square::g1))))
-                {
-                    Move move;
-                    move.from = Square::e1;
-                    move.to = Square::g1;
-                    move.isCastling = true;
-                    moves.push_back(move);
-                }
-            }
-        }
-        if (currentState->castlingRights & 0b0100 && (pieceBitboards[5] & (1ULL << static_cast<int>(Square::e1))) && (pieceBitboards[1] & (1ULL << static_cast<int>(Square::a1)))) // White queenside castling
-        {
-            if (!((occupiedBitboard & (1ULL << static_cast<int>(Square::b1))) || (occupiedBitboard & (1ULL << static_cast<int>(Square::c1))) ||
-                  (occupiedBitboard & (1ULL << static_cast<int>(Square::d1)))))
-            {
-                if (!(opponentAttacks & (1ULL << static_cast<int>(Square::c1))) && !(opponentAttacks & (1ULL << static_cast<int>(Square::d1))))
-                {
-                    Move move;
-                    move.from = Square::e1;
-                    move.to = Square::c1;
-                    move.isCastling = true;
-                    moves.push_back(move);
-                }
-            }
-        }
+        moves.push_back(Move(static_cast<Square>(kingSq), static_cast<Square>(kingSq + 2), Move::KingCastle));
     }
-    else
+    if (sides & 2)
     {
-        if (currentState->castlingRights & 0b0010 && (pieceBitboards[11] & (1ULL << static_cast<int>(Square::e8))) && (pieceBitboards[7] & (1ULL << static_cast<int>(Square::h8)))) // Black kingside castling
-        {
-            if (!((occupiedBitboard & (1ULL << static_cast<int>(Square::f8))) || (occupiedBitboard & (1ULL << static_cast<int>(Square::g8)))))
-            {
-                // Check if the squares f8 and g8 are will not put the king in check
-                // or pass through a check
-                if (!(opponentAttacks & (1ULL << static_cast<int>(Square::f8))) && !(opponentAttacks & (1ULL << static_cast<int>(Square::g8))))
-                {
-                    Move move;
-                    move.from = Square::e8;
-                    move.to = Square::g8;
-                    move.isCastling = true;
-                    moves.push_back(move);
-                }
-            }
-        }
+        moves.push_back(Move(static_cast<Square>(kingSq), static_cast<Square>(kingSq - 2), Move::QueenCastle));
     }
-    if (currentState->castlingRights & 0b0001 && (pieceBitboards[11] & (1ULL << static_cast<int>(Square::e8))) && (pieceBitboards[7] & (1ULL << static_cast<int>(Square::a8)))) // Black queenside castling
+}
+
+template <Color Us>
+int ChessGame::castlingSides(bool legal) const
+{
+    // Castling for the current turn. Our back rank is rank 1 for white and
+    // rank 8 for black; the masks below are built on rank 1.
+    constexpr int rankOffset = Us == Color::White ? 0 : 56;
+    constexpr char kingSideRight = Us == Color::White ? 0b1000 : 0b0010;
+    constexpr char queenSideRight = Us == Color::White ? 0b0100 : 0b0001;
+    constexpr int kingSq = static_cast<int>(Square::e1) + rankOffset;
+    constexpr uint64_t kingSideEmpty = ((1ULL << static_cast<int>(Square::f1)) | (1ULL << static_cast<int>(Square::g1))) << rankOffset;
+    constexpr uint64_t queenSideEmpty = ((1ULL << static_cast<int>(Square::b1)) | (1ULL << static_cast<int>(Square::c1)) | (1ULL << static_cast<int>(Square::d1))) << rankOffset;
+    constexpr uint64_t queenSidePath = ((1ULL << static_cast<int>(Square::c1)) | (1ULL << static_cast<int>(Square::d1))) << rankOffset; // b1/b8 may be attacked
+
+    if (!(pieceBitboards[Side<Us>::King] & (1ULL << kingSq)))
     {
-        if (!((occupiedBitboard & (1ULL << static_cast<int>(Square::b8))) || (occupiedBitboard & (1ULL << static_cast<int>(Square::c8))) ||
-              (occupiedBitboard & (1ULL << static_cast<int>(Square::d8)))))
-        {
-            if (!(opponentAttacks & (1ULL << static_cast<int>(Square::c8))) && !(opponentAttacks & (1ULL << static_cast<int>(Square::d8))))
-            {
-                Move move;
-                move.from = Square::e8;
-                move.to = Square::c8;
-                move.isCastling = true;
-                moves.push_back(move);
-            }
-        }
+        return 0;
     }
+    uint64_t rooks = pieceBitboards[Side<Us>::Rook];
+    int sides = 0;
+
+    // The squares the king passes and lands on must be empty and not attacked (checked by isLegal() when pseudo-legal)
+    if ((currentState()->castlingRights & kingSideRight) && (rooks & (1ULL << (static_cast<int>(Square::h1) + rankOffset))) &&
+        !(occupiedBitboard & kingSideEmpty) && !(legal && (opponentAttacks & kingSideEmpty)))
+    {
+        sides |= 1;
+    }
+    if ((currentState()->castlingRights & queenSideRight) && (rooks & (1ULL << (static_cast<int>(Square::a1) + rankOffset))) &&
+        !(occupiedBitboard & queenSideEmpty) && !(legal && (opponentAttacks & queenSidePath)))
+    {
+        sides |= 2;
+    }
+    return sides;
 }
 
 // Method to extract moves from a bitboard of destinations
-void ChessGame::addMovesFromBitboard(std::vector<Move> &moves, uint64_t moveBitboard,
+void ChessGame::addMovesFromBitboard(MoveList &moves, uint64_t moveBitboard,
                                      int pieceType, int offsetForSource) const
 {
     // Loop through each set bit in the moveBitboard
@@ -1363,77 +1227,13 @@ void ChessGame::addMovesFromBitboard(std::vector<Move> &moves, uint64_t moveBitb
         int sourceSq = destSq - offsetForSource;
 
         // Create and add the move
-        Move move;
-        move.from = static_cast<Square>(sourceSq);
-        move.to = static_cast<Square>(destSq);
-        moves.push_back(move);
+        moves.push_back(Move(static_cast<Square>(sourceSq), static_cast<Square>(destSq)));
 
         // Clear the processed bit
         moveBitboard &= moveBitboard - 1; // Clear least significant bit
     }
 }
 
-void ChessGame::initializeKnightAttacks()
-{
-    // Initialize knight pseudo-attack bitboards
-    for (int i = 0; i < 64; ++i)
-    {
-        uint64_t attacks = 0;
-        uint64_t bitboardWithPiece = (1ULL << i);
-
-        if (bitboardWithPiece >> 17 & ~fileConst[7]) // Down-Down-Left
-            attacks |= bitboardWithPiece >> 17;
-        if (bitboardWithPiece >> 15 & ~fileConst[0]) // Down-Down-Right
-            attacks |= bitboardWithPiece >> 15;
-        if (bitboardWithPiece >> 10 & ~(fileConst[7] | fileConst[6])) // Down-Left-Left
-            attacks |= bitboardWithPiece >> 10;
-        if (bitboardWithPiece >> 6 & ~(fileConst[0] | fileConst[1])) // Down-Right-Right
-            attacks |= bitboardWithPiece >> 6;
-        if (bitboardWithPiece << 17 & ~fileConst[0]) // Up-Up-Right
-            attacks |= bitboardWithPiece << 17;
-        if (bitboardWithPiece << 15 & ~fileConst[7]) // Up-Up-Left
-            attacks |= bitboardWithPiece << 15;
-        if (bitboardWithPiece << 10 & ~(fileConst[0] | fileConst[1])) // Up-Right-Right
-            attacks |= bitboardWithPiece << 10;
-        if (bitboardWithPiece << 6 & ~(fileConst[7] | fileConst[6])) // Up-Left-Left
-            attacks |= bitboardWithPiece << 6;
-
-        knightPseudoAttacks[i] = attacks;
-    }
-    return;
-}
-
-void ChessGame::initializeKingAttacks()
-{
-    // Initialize king pseudo-attack bitboards
-    for (int i = 0; i < 64; ++i)
-    {
-        uint64_t attacks = 0;
-        uint64_t bitboardWithPiece = (1ULL << i);
-
-        // King can move one square in any direction
-        if (i % 8 != 7)                        // Not on the right edge
-            attacks |= bitboardWithPiece << 1; // Right
-        if (i % 8 != 0)                        // Not on the left edge
-            attacks |= bitboardWithPiece >> 1; // Left
-        if (i < 56)                            // Not on the top edge
-            attacks |= bitboardWithPiece << 8; // Up
-        if (i > 7)                             // Not on the bottom edge
-            attacks |= bitboardWithPiece >> 8; // Down
-        if (i % 8 != 7 && i < 56)              // Not on the right edge and not on the top edge
-            attacks |= bitboardWithPiece << 9; // Up-Right
-        if (i % 8 != 0 && i < 56)              // Not on the left edge and not on the top edge
-            attacks |= bitboardWithPiece << 7; // Up-Left
-        if (i % 8 != 7 && i > 7)               // Not on the right edge and not on the bottom edge
-            attacks |= bitboardWithPiece >> 7; // Down-Right
-        if (i % 8 != 0 && i > 7)               // Not on the left edge and not on the bottom edge
-            attacks |= bitboardWithPiece >> 9; // Down-Left
-
-        kingPseudoAttacks[i] = attacks;
-    }
-    return;
-}
-
 int ChessGame::pop_lsb(uint64_t &bb) const
 {
     int index = __builtin_ctzll(bb); // Count trailing zeros
@@ -1467,107 +1267,6 @@ void ChessGame::printBitboard(uint64_t bitboard) const
     }
 }
 
-void ChessGame::initializeRayAttacks()
-{
-    // Initialize ray attacks table to use as lookup for sliding pieces
-    uint64_t northMask = 0x0101010101010100;
-    for (int sq = 0; sq < 64; ++sq)
-    {
-        rayAttacks[sq][static_cast<int>(Direction::North)] = northMask;
-        northMask <<= 1;
-    }
-    uint64_t eastMask = 0x00000000000000FE;
-    for (int file = 0; file < 8; ++file)
-    {
-        uint64_t eastMaskCopy = eastMask;
-        for (int rank = 0; rank < 8; ++rank)
-        {
-            int sq = rank * 8 + file;
-            rayAttacks[sq][static_cast<int>(Direction::East)] = eastMaskCopy;
-            eastMaskCopy <<= 8;
-        }
-        pop_msb(eastMask); // Clear the most significant bit
-        eastMask <<= 1;    // Shift left to prepare for the next file
-    }
-    uint64_t northEastMask = 0x8040201008040200;
-    for (int file = 0; file < 8; ++file)
-    {
-        uint64_t northEastMaskCopy = northEastMask;
-        for (int rank = 0; rank < 8; ++rank)
-        {
-            int sq = rank * 8 + file;
-            rayAttacks[sq][static_cast<int>(Direction::NorthEast)] = northEastMaskCopy;
-            northEastMaskCopy <<= 8;
-        }
-        pop_msb(northEastMask); // Clear the most significant bit
-        northEastMask <<= 1;    // Shift left to prepare for the next file
-    }
-
-    uint64_t southMask = 0x0080808080808080;
-    for (int sq = 63; sq >= 0; --sq)
-    {
-        rayAttacks[sq][static_cast<int>(Direction::South)] = southMask;
-        southMask >>= 1;
-    }
-
-    uint64_t westMask = 0x7F00000000000000;
-    for (int file = 7; file >= 0; --file)
-    {
-        uint64_t westMaskCopy = westMask;
-        for (int rank = 7; rank >= 0; --rank)
-        {
-            int sq = rank * 8 + file;
-            rayAttacks[sq][static_cast<int>(Direction::West)] = westMaskCopy;
-            westMaskCopy >>= 8;
-        }
-        pop_lsb(westMask); // Clear the most significant bit
-        westMask >>= 1;    // Shift right to prepare for the next file
-    }
-
-    uint64_t southWestMask = 0x0040201008040201;
-    for (int file = 7; file >= 0; --file)
-    {
-        uint64_t southWestMaskCopy = southWestMask;
-        for (int rank = 7; rank >= 0; --rank)
-        {
-            int sq = rank * 8 + file;
-            rayAttacks[sq][static_cast<int>(Direction::SouthWest)] = southWestMaskCopy;
-            southWestMaskCopy >>= 8;
-        }
-        pop_lsb(southWestMask); // Clear the most significant bit
-        southWestMask >>= 1;    // Shift right to prepare for the next file
-    }
-
-    uint64_t northWestMask = 0x0102040810204000;
-    for (int file = 7; file >= 0; --file)
-    {
-        uint64_t northWestMaskCopy = northWestMask;
-        for (int rank = 0; rank < 8; ++rank)
-        {
-            int sq = rank * 8 + file;
-            rayAttacks[sq][static_cast<int>(Direction::NorthWest)] = northWestMaskCopy;
-            northWestMaskCopy <<= 8;
-        }
-        pop_msb(northWestMask); // Clear the most significant bit
-        northWestMask >>= 1;    // Shift left to prepare for the next file
-    }
-
-    uint64_t southEastMask = 0x0002040810204080;
-    for (int file = 0; file < 8; ++file)
-    {
-        uint64_t southEastMaskCopy = southEastMask;
-        for (int rank = 7; rank >= 0; --rank)
-        {
-            int sq = rank * 8 + file;
-            rayAttacks[sq][static_cast<int>(Direction::SouthEast)] = southEastMaskCopy;
-            southEastMaskCopy >>= 8;
-        }
-        pop_lsb(southEastMask); // Clear the most significant bit
-        southEastMask <<= 1;    // Shift right to prepare for the next file
-    }
-    return;
-}
-
 uint64_t ChessGame::getPositiveRayAttacks(uint64_t occupied, Direction dir8, unsigned long square) const
 {
     uint64_t attacks = rayAttacks[square][static_cast<int>(dir8)];
@@ -1602,16 +1301,12 @@ uint64_t ChessGame::getNegativeRayAttacks(uint64_t occupied, Direction dir8, uns
 
 uint64_t ChessGame::getBishopAttacks(uint64_t occupied, int sq) const
 {
-    return diagonalAttacks(occupied, sq) | antiDiagAttacks(occupied, sq);
+    return Attacks::bishopAttacks(occupied, sq); // Same result as diagonalAttacks | antiDiagAttacks
 }
 
 uint64_t ChessGame::getRookAttacks(uint64_t occupied, int sq) const
 {
-    // printBitboard(fileAttacks(occupied, sq));
-    // std::cout << "-------------------------" << std::endl;
-    // printBitboard(rankAttacks(occupied, sq));
-    // std::cout << "-------------------------" << std::endl;
-    return fileAttacks(occupied, sq) | rankAttacks(occupied, sq);
+    return Attacks::rookAttacks(occupied, sq); // Same result as fileAttacks | rankAttacks
 }
 
 uint64_t ChessGame::getQueenAttacks(uint64_t occupied, int sq) const
@@ -1640,12 +1335,13 @@ void ChessGame::printBoardWithMovesByPiece(Square square) const
         if (pieceBitboards[i] & (1ULL << static_cast<int>(square)))
         {
             std::cout << "Piece " << i << " at square " << static_cast<int>(square) << " can move to: ";
-            std::vector<Move> moves = generateMoves();
+            MoveList moves;
+            generateMoves(moves);
             for (const Move &move : moves)
             {
-                if (move.from == square)
+                if (move.from() == square)
                 {
-                    std::cout << getSquareName(move.to) << " ";
+                    std::cout << getSquareName(move.to()) << " ";
                 }
             }
             std::cout << std::endl;
@@ -1662,37 +1358,281 @@ std::string ChessGame::getSquareName(Square square)
     return std::string(1, 'a' + file) + std::to_string(rank + 1);
 }
 
-bool ChessGame::isMoveLegal(const ChessGame::Move &move) const
+bool ChessGame::isLegal(const ChessGame::Move &move) const
 {
-    // Simulate the move and check if it results in a legal position
-    return true;
+    ensurePositionInfo();
+    return whiteTurn ? isLegalFor<Color::White>(move) : isLegalFor<Color::Black>(move);
 }
 
-void ChessGame::preworkPosition()
+template <Color Us>
+bool ChessGame::isLegalFor(const ChessGame::Move &move) const
 {
-    whitePieces = pieceBitboards[0] | pieceBitboards[1] | pieceBitboards[2] | pieceBitboards[3] | pieceBitboards[4] | pieceBitboards[5];
-    blackPieces = pieceBitboards[6] | pieceBitboards[7] | pieceBitboards[8] | pieceBitboards[9] | pieceBitboards[10] | pieceBitboards[11];
-    occupiedBitboard = whitePieces | blackPieces;
-    emptyBitboard = ~occupiedBitboard;
-    // Precompute knight and king attacks
-    // initializeKnightAttacks();
-    // initializeKingAttacks();
+    // Checks are already evaded by the generator, so only pins and king safety are left
+    constexpr Color Them = Side<Us>::Them;
+    int from = static_cast<int>(move.from());
+    int to = static_cast<int>(move.to());
+    uint64_t kingBB = pieceBitboards[Side<Us>::King];
+
+    if (move.isCastling())
+    {
+        // The king may not pass through or land on an attacked square
+        int step = move.flags() == Move::KingCastle ? 1 : -1;
+        return !(attackersTo(from + step, occupiedBitboard) & piecesOf<Them>()) &&
+               !(attackersTo(to, occupiedBitboard) & piecesOf<Them>());
+    }
+    if (kingBB & (1ULL << from))
+    {
+        // Lift the king off the board so a slider checking along the line still covers the square behind it
+        return !(attackersTo(to, occupiedBitboard ^ kingBB) & piecesOf<Them>());
+    }
+    bool isPinned = pinInfoStruct.pinned_pieces & (1ULL << from);
+    if (move.isEnPassant())
+    {
+        return isPinned ? (pinLine(from) & (1ULL << to)) != 0 : enPassantIsLegal<Us>(from, to);
+    }
+    return !isPinned || (pinLine(from) & (1ULL << to));
+}
 
-    // Initialize ray attacks for sliding pieces
-    // initializeRayAttacks();
+bool ChessGame::isPseudoLegal(const ChessGame::Move &move) const
+{
+    ensurePositionInfo();
+    return whiteTurn ? isPseudoLegalFor<Color::White>(move) : isPseudoLegalFor<Color::Black>(move);
+}
+
+template <Color Us>
+bool ChessGame::isPseudoLegalFor(const ChessGame::Move &move) const
+{
+    int from = static_cast<int>(move.from());
+    int to = static_cast<int>(move.to());
+    uint64_t fromBB = 1ULL << from;
+    uint64_t toBB = 1ULL << to;
+    if (from == to || !(piecesOf<Us>() & fromBB))
+    {
+        return false;
+    }
+    int type = (static_cast<int>(board[from]) - 1) % 6; // Bitboard index modulo 6: p, r, n, b, q, k
+
+    if (move.isCastling())
+    {
+        if (type != 5 || checkInfoStruct.isInCheck)
+        {
+            return false;
+        }
+        int sides = castlingSides<Us>(false); // Rights, rook and empty squares; attacked squares are left to isLegal()
+        return move.flags() == Move::KingCastle ? (sides & 1) && to == from + 2 : (sides & 2) && to == from - 2;
+    }
+    if (move.isEnPassant())
+    {
+        return type == 0 && move.to() == currentState()->enPassantSquare && (enPassantCapturers<Us>(false) & fromBB);
+    }
+
+    // The capture flag must match what stands on the target square
+    if (move.isCapture() ? !(piecesOf<Side<Us>::Them>() & toBB) : (occupiedBitboard & toBB) != 0)
+    {
+        return false;
+    }
+
+    if (type == 5)
+    {
+        if (move.flags() != Move::Quiet && move.flags() != Move::Capture)
+        {
+            return false;
+        }
+        return (kingPseudoAttacks[from] & toBB) != 0; // Whether the target is attacked is left to isLegal()
+    }
+
+    // Other pieces must capture the checker or block, and cannot answer a double check at all
+    if (checkInfoStruct.isInCheck &&
+        (__builtin_popcountll(checkInfoStruct.checkers) >= 2 || !(toBB & (checkInfoStruct.checkers | checkInfoStruct.checkBlockSquares))))
+    {
+        return false;
+    }
+
+    if (type == 0)
+    {
+        if (move.isPromotion() != ((toBB & rankConst[Us == Color::White ? 7 : 0]) != 0))
+        {
+            return false; // A pawn promotes exactly when it reaches the last rank
+        }
+        if (!move.isPromotion() && move.flags() != Move::Quiet && move.flags() != Move::Capture && !move.isDoublePawnPush())
+        {
+            return false;
+        }
+        if (move.isCapture())
+        {
+            return (pawnAttacks<Us>(fromBB) & toBB) != 0;
+        }
+        if (move.isDoublePawnPush())
+        {
+            return (fromBB & rankConst[Us == Color::White ? 1 : 6]) && to == from + 2 * Side<Us>::Up &&
+                   !(occupiedBitboard & (1ULL << (from + Side<Us>::Up)));
+        }
+        return to == from + Side<Us>::Up;
+    }
+
+    if (move.flags() != Move::Quiet && move.flags() != Move::Capture)
+    {
+        return false;
+    }
+    if (type == 2)
+    {
+        return (knightPseudoAttacks[from] & toBB) != 0;
+    }
+    // Sliders: the squares must share a line of the right kind with nothing in between
+    uint64_t ray = getRayBetween(from, to);
+    bool straight = from % 8 == to % 8 || from / 8 == to / 8;
+    if (!ray || (type == 1 && !straight) || (type == 3 && straight))
+    {
+        return false;
+    }
+    return !(ray & ~toBB & occupiedBitboard);
+}
 
-    // Reset the board to the initial position
-    pinInfoStruct = calculatePins(whiteTurn ? blackPieces : whitePieces, whiteTurn);
+uint64_t ChessGame::attackersTo(int square, uint64_t occupied) const
+{
+    uint64_t bb = 1ULL << square;
+    // A pawn attacks the square if a pawn of the other colour on it would attack the pawn
+    return (pawnAttacks<Color::Black>(bb) & pieceBitboards[0]) |
+           (pawnAttacks<Color::White>(bb) & pieceBitboards[6]) |
+           (knightPseudoAttacks[square] & (pieceBitboards[2] | pieceBitboards[8])) |
+           (kingPseudoAttacks[square] & (pieceBitboards[5] | pieceBitboards[11])) |
+           (getRookAttacks(occupied, square) & (pieceBitboards[1] | pieceBitboards[7] | pieceBitboards[4] | pieceBitboards[10])) |
+           (getBishopAttacks(occupied, square) & (pieceBitboards[3] | pieceBitboards[9] | pieceBitboards[4] | pieceBitboards[10]));
+}
+
+int ChessGame::seeCaptureGain(const ChessGame::Move &move) const
+{
+    int gain = 0;
+    if (move.isEnPassant())
+        gain = seeValues[0];
+    else if (move.isCapture())
+        gain = pieceValue(getPieceAtSquare(move.to()));
+    if (move.isPromotion())
+        gain += pieceValue(move.promotionPiece()) - seeValues[0];
+    return gain;
+}
+
+int ChessGame::seeMovedValue(const ChessGame::Move &move) const
+{
+    Piece piece = move.isPromotion() ? move.promotionPiece() : getPieceAtSquare(move.from());
+    return pieceValue(piece);
+}
+
+int ChessGame::popLeastValuableAttacker(uint64_t candidates, int square, uint64_t &occupied, uint64_t &attackers) const
+{
+    static constexpr int cheapestFirst[6] = {0, 2, 3, 1, 4, 5}; // p, n, b, r, q, k
+    for (int type : cheapestFirst)
+    {
+        uint64_t bb = candidates & (pieceBitboards[type] | pieceBitboards[type + 6]);
+        if (!bb)
+            continue;
+        occupied ^= bb & -bb;
+        // X-rays: only a piece that attacks along a line can uncover a slider behind it
+        if (type == 0 || type == 3 || type == 4 || type == 5)
+            attackers |= getBishopAttacks(occupied, square) & (pieceBitboards[3] | pieceBitboards[9] | pieceBitboards[4] | pieceBitboards[10]);
+        if (type == 1 || type == 4 || type == 5)
+            attackers |= getRookAttacks(occupied, square) & (pieceBitboards[1] | pieceBitboards[7] | pieceBitboards[4] | pieceBitboards[10]);
+        return type;
+    }
+    return -1;
+}
+
+int ChessGame::see(const ChessGame::Move &move) const
+{
+    if (move.isCastling())
+        return 0;
+
+    int from = static_cast<int>(move.from());
+    int to = static_cast<int>(move.to());
+    uint64_t occupied = occupiedBitboard ^ (1ULL << from);
+    if (move.isEnPassant())
+        occupied ^= 1ULL << (to + (whiteTurn ? -8 : 8));
+    uint64_t attackers = attackersTo(to, occupied);
+
+    // Swap list: gain[d] is what the side making capture d nets if the exchange stopped right after it
+    int gain[32];
+    int depth = 0;
+    gain[0] = seeCaptureGain(move);
+    int onSquare = seeMovedValue(move);
+    bool white = whiteTurn;
+    while (depth < 31)
+    {
+        white = !white;
+        attackers &= occupied;
+        uint64_t ours = attackers & (white ? whitePieces : blackPieces);
+        if (!ours)
+            break;
+        int type = popLeastValuableAttacker(ours, to, occupied, attackers);
+        if (type == 5 && (attackers & occupied & (white ? blackPieces : whitePieces)))
+            break; // The king may not recapture into an attack
+        ++depth;
+        gain[depth] = onSquare - gain[depth - 1];
+        onSquare = seeValues[type];
+    }
+    // Each side only makes its capture if that beats stopping before it
+    while (depth > 0)
+    {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        --depth;
+    }
+    return gain[0];
+}
+
+bool ChessGame::seeGE(const ChessGame::Move &move, int threshold) const
+{
+    if (move.isCastling())
+        return threshold <= 0;
+
+    // balance is what we stand to gain above the threshold, from the point of view of the side to capture next
+    int balance = seeCaptureGain(move) - threshold;
+    if (balance < 0)
+        return false; // Not enough even if the piece is never recaptured
+    balance = seeMovedValue(move) - balance;
+    if (balance <= 0)
+        return true; // Enough even if the piece is lost for nothing
+
+    int from = static_cast<int>(move.from());
+    int to = static_cast<int>(move.to());
+    uint64_t occupied = occupiedBitboard ^ (1ULL << from);
+    if (move.isEnPassant())
+        occupied ^= 1ULL << (to + (whiteTurn ? -8 : 8));
+    uint64_t attackers = attackersTo(to, occupied);
+
+    bool result = true; // Whether the side to move reaches the threshold if the opponent stops now
+    bool white = whiteTurn;
+    while (true)
+    {
+        white = !white;
+        attackers &= occupied;
+        uint64_t ours = attackers & (white ? whitePieces : blackPieces);
+        if (!ours)
+            break;
+        result = !result;
+        int type = popLeastValuableAttacker(ours, to, occupied, attackers);
+        if (type == 5)
+            // A king capture only stands if the other side has nothing left to recapture with
+            return (attackers & occupied & (white ? blackPieces : whitePieces)) ? !result : result;
+        balance = seeValues[type] - balance;
+        if (balance < result)
+            break; // Settled for the side that just captured, whatever follows
+    }
+    return result;
+}
+
+void ChessGame::preworkPosition()
+{
+    updateOccupancy();
+    invalidatePositionInfo();
+    ensurePositionInfo();
     /*for (int i = 0; i < 64; ++i)
     {
         if (pinInfoStruct.pinned_pieces & (1ULL << i))
         {
             std::cout << "Pinned piece at square: " << getSquareName(static_cast<Square>(i)) << std::endl;
             std::cout << "Pin ray: ";
-            printBitboard(pinInfoStruct.pin_rays[i]);
+            printBitboard(pinLine(i));
         }
     }*/
-    checkInfoStruct = calculateCheckInfo();
     /*if (checkInfoStruct.isInCheck)
     {
         std::cout << "Checkers: " << std::endl;
@@ -1705,7 +1645,7 @@ void ChessGame::preworkPosition()
     {
         std::cout << "No check detected." << std::endl;
     }*/
-    generateMoves();
+    generateMoves(movesVector);
     if (movesVector.empty())
     {
         gameOver = true; // No legal moves available, game over
@@ -1722,250 +1662,113 @@ void ChessGame::preworkPosition()
         }
         // std::cout << "Game over: No legal moves available." << std::endl;
     }
-    currentState->checkInfo = checkInfoStruct;
-    currentState->pinInfo = pinInfoStruct;
     return;
 }
 
-PinInfo ChessGame::calculatePins(uint64_t enemy_pieces, bool is_white) const
+void ChessGame::ensurePositionInfo() const
 {
-    PinInfo pins = {};
-
-    int king_square = __builtin_ctzll(pieceBitboards[is_white ? 5 : 11]); // Get the king square
-    uint64_t occupied = occupiedBitboard;
-
-    // Check for orthogonal pins (rooks/queens)
-    uint64_t enemy_sliding_ortho_pieces = is_white ? (pieceBitboards[7] | pieceBitboards[10]) : // Black rooks/queens
-                                              (pieceBitboards[1] | pieceBitboards[4]);          // White rooks/queens
+    if (positionInfoValid)
+    {
+        return;
+    }
+    if (whiteTurn)
+    {
+        updatePositionInfo<Color::White>();
+    }
+    else
+    {
+        updatePositionInfo<Color::Black>();
+    }
+    positionInfoValid = true;
+}
 
-    // Check orthogonal directions (North, East, South, West)
-    for (int dir = static_cast<int>(Direction::North); dir <= static_cast<int>(Direction::West); dir += 2)
+void ChessGame::ensureOpponentAttacks() const
+{
+    if (opponentAttacksValid)
     {
-        uint64_t ray;
-        if (dir < 4)
-        { // Positive Rays
-            ray = getPositiveRayAttacks(enemy_pieces, static_cast<Direction>(dir), king_square);
-        }
-        else
-        {
-            ray = getNegativeRayAttacks(enemy_pieces, static_cast<Direction>(dir), king_square);
-        }
+        return;
+    }
+    opponentAttacks = 0;
+    if (whiteTurn)
+    {
+        generateOpponentAttacks<Color::White>(); // Squares our king may not step on
+    }
+    else
+    {
+        generateOpponentAttacks<Color::Black>();
+    }
+    opponentAttacksValid = true;
+}
 
-        if (ray == 0)
-            continue; // No ray in this direction
+template <Color Us>
+void ChessGame::updatePositionInfo() const
+{
+    pinInfoStruct = calculatePins<Us>(piecesOf<Side<Us>::Them>());
+    checkInfoStruct = calculateCheckInfo<Us>();
+}
 
-        // Check if there's an enemy sliding piece on this ray
-        uint64_t enemy_on_ray = ray & enemy_sliding_ortho_pieces;
-        if (enemy_on_ray)
-        {
-            // Get the closest enemy piece
-            int enemy_square = (dir < 4) ? __builtin_ctzll(enemy_on_ray) : (63 - __builtin_clzll(enemy_on_ray));
+template <Color Us>
+PinInfo ChessGame::calculatePins(uint64_t enemy_pieces) const
+{
+    PinInfo pins = {};
+    constexpr Color Them = Side<Us>::Them;
 
-            // Get ray between king and enemy piece
-            uint64_t pin_ray = getRayBetween(king_square, enemy_square);
-            if (pin_ray)
-            {
-                // Count our pieces on this ray (excluding king)
-                uint64_t our_pieces_on_ray = pin_ray & (whiteTurn ? whitePieces : blackPieces) & ~pieceBitboards[is_white ? 5 : 11];
-                if (__builtin_popcountll(our_pieces_on_ray) == 1)
-                {
-                    // Exactly one piece - it's pinned!
-                    int pinned_square = __builtin_ctzll(our_pieces_on_ray);
-                    pins.pinned_pieces |= (1ULL << pinned_square);
-                    pins.pin_rays[pinned_square] = pin_ray | (1ULL << enemy_square);
-                }
-            }
-        }
-    }
+    int king_square = __builtin_ctzll(pieceBitboards[Side<Us>::King]); // Get the king square
+
+    // Check for orthogonal pins (rooks/queens)
+    uint64_t enemy_sliding_ortho_pieces = pieceBitboards[Side<Them>::Rook] | pieceBitboards[Side<Them>::Queen];
 
     // Check for diagonal pins (bishops/queens)
-    uint64_t enemy_sliding_diag_pieces = is_white ? (pieceBitboards[9] | pieceBitboards[10]) : // Black bishops/queens
-                                             (pieceBitboards[3] | pieceBitboards[4]);          // White bishops/queens
+    uint64_t enemy_sliding_diag_pieces = pieceBitboards[Side<Them>::Bishop] | pieceBitboards[Side<Them>::Queen];
 
-    // Check diagonal directions (NorthWest, NorthEast, SouthEast, SouthWest)
-    for (int dir = static_cast<int>(Direction::NorthWest); dir <= static_cast<int>(Direction::West); dir += 2)
-    {
-        uint64_t ray;
-        if (dir < 4)
-        { // Positive Rays
-            ray = getPositiveRayAttacks(enemy_pieces, static_cast<Direction>(dir), king_square);
-        }
-        else
-        {
-            ray = getNegativeRayAttacks(enemy_pieces, static_cast<Direction>(dir), king_square);
-        }
+    // Only enemy pieces block the rays, so these are the closest enemy sliders on each line through the king
+    uint64_t pinners = (getRookAttacks(enemy_pieces, king_square) & enemy_sliding_ortho_pieces) |
+                       (getBishopAttacks(enemy_pieces, king_square) & enemy_sliding_diag_pieces);
 
-        if (ray == 0)
-            continue; // No ray in this direction
+    while (pinners)
+    {
+        int enemy_square = pop_lsb(pinners);
 
-        // Check if there's an enemy sliding piece on this ray
-        uint64_t enemy_on_ray = ray & enemy_sliding_diag_pieces;
-        if (enemy_on_ray)
+        // Get ray between king and enemy piece
+        uint64_t pin_ray = getRayBetween(king_square, enemy_square);
+        // Count our pieces on this ray (excluding king)
+        uint64_t our_pieces_on_ray = pin_ray & piecesOf<Us>() & ~pieceBitboards[Side<Us>::King];
+        if (__builtin_popcountll(our_pieces_on_ray) == 1)
         {
-            // Get the closest enemy piece
-            int enemy_square = (dir < 4) ? __builtin_ctzll(enemy_on_ray) : (63 - __builtin_clzll(enemy_on_ray));
-
-            // Get ray between king and enemy piece
-            uint64_t pin_ray = getRayBetween(king_square, enemy_square);
-            if (pin_ray)
-            {
-                // Count our pieces on this ray (excluding king)
-                uint64_t our_pieces_on_ray = pin_ray & (whiteTurn ? whitePieces : blackPieces) & ~pieceBitboards[whiteTurn ? 5 : 11];
-                if (__builtin_popcountll(our_pieces_on_ray) == 1)
-                {
-                    // Exactly one piece - it's pinned!
-                    int pinned_square = __builtin_ctzll(our_pieces_on_ray);
-                    pins.pinned_pieces |= (1ULL << pinned_square);
-                    pins.pin_rays[pinned_square] = pin_ray | (1ULL << enemy_square);
-                }
-            }
+            // Exactly one piece - it's pinned!
+            int pinned_square = __builtin_ctzll(our_pieces_on_ray);
+            pins.pinned_pieces |= (1ULL << pinned_square);
         }
     }
 
     return pins;
 }
 
-uint64_t ChessGame::getRayBetween(int from, int to) const
-{
-    // Get the ray between two squares if they're aligned
-    // Calculate ray direction
-    int diff = to - from;
-    int fileDistance = (to % 8) - (from % 8);
-    int rankDistance = (to / 8) - (from / 8);
-
-    // Check if squares are aligned
-    if (fileDistance != 0 && rankDistance != 0 &&
-        std::abs(fileDistance) != std::abs(rankDistance))
-        return 0; // Not on same diagonal or rank/file
-
-    // Calculate direction
-    int direction = 0;
-    if (fileDistance > 0 && rankDistance == 0)
-        direction = static_cast<int>(Direction::East); // East
-    else if (fileDistance > 0 && rankDistance > 0)
-        direction = static_cast<int>(Direction::NorthEast); // Northeast
-    else if (fileDistance == 0 && rankDistance > 0)
-        direction = static_cast<int>(Direction::North); // North
-    else if (fileDistance < 0 && rankDistance > 0)
-        direction = static_cast<int>(Direction::NorthWest); // Northwest
-    else if (fileDistance < 0 && rankDistance == 0)
-        direction = -static_cast<int>(Direction::West);
-    // West
-    else if (fileDistance < 0 && rankDistance < 0)
-        direction = -static_cast<int>(Direction::SouthWest);
-    // Southwest
-    else if (fileDistance == 0 && rankDistance < 0)
-        direction = -static_cast<int>(Direction::South);
-    // South
-    else if (fileDistance > 0 && rankDistance < 0)
-        direction = -static_cast<int>(Direction::SouthEast);
-    // Southeast
-
-    uint64_t ray = 0;
-    uint64_t toSquareBitboard = 1ULL << to;
-    if (direction > 0) // TODO: make this more efficient
-    {
-        ray = getPositiveRayAttacks(toSquareBitboard, static_cast<Direction>(direction), from);
-        // pop_msb(ray);
-    }
-    else
-    {
-        direction = -direction; // Convert to positive direction for calculations
-        ray = getNegativeRayAttacks(toSquareBitboard, static_cast<Direction>(direction), from);
-    }
-    // ray = (direction > 0) ? getPositiveRayAttacks(toSquareBitboard, static_cast<Direction>(direction), from)
-    //                       : getNegativeRayAttacks(toSquareBitboard, static_cast<Direction>(-direction), from);
-
-    return ray;
-}
-
-CheckInfo ChessGame::calculateCheckInfo()
+template <Color Us>
+CheckInfo ChessGame::calculateCheckInfo() const
 {
     CheckInfo info = {};
+    constexpr Color Them = Side<Us>::Them;
 
-    int kingSquare = __builtin_ctzll(pieceBitboards[whiteTurn ? 5 : 11]); // Get the king square
-    uint64_t enemy_pieces = whiteTurn ? blackPieces : whitePieces;
-
-    // Pawn attacks
-    uint64_t pawnCheckMask = 0;
-    if (whiteTurn)
-    { // White king, check from black pawns
-        // Check FROM northwest and northeast squares (black pawns above the king)
-        if ((kingSquare % 8) > 0)                      // Not on a-file
-            pawnCheckMask |= 1ULL << (kingSquare + 7); // Northwest attack
-        if ((kingSquare % 8) < 7)                      // Not on h-file
-            pawnCheckMask |= 1ULL << (kingSquare + 9); // Northeast attack
+    int kingSquare = __builtin_ctzll(pieceBitboards[Side<Us>::King]); // Get the king square
+    uint64_t kingBB = 1ULL << kingSquare;
 
-        // Check for black pawns (pieceBitboards[6])
-        info.checkers |= pawnCheckMask & pieceBitboards[6];
-    }
-    else
-    { // Black king, check from white pawns
-        // Check FROM southwest and southeast squares (white pawns below the king)
-        if ((kingSquare % 8) > 0)                      // Not on a-file
-            pawnCheckMask |= 1ULL << (kingSquare - 9); // Southwest attack
-        if ((kingSquare % 8) < 7)                      // Not on h-file
-            pawnCheckMask |= 1ULL << (kingSquare - 7); // Southeast attack
-
-        // Check for white pawns (pieceBitboards[0])
-        info.checkers |= pawnCheckMask & pieceBitboards[0];
-    }
+    // Pawn attacks: an enemy pawn checks from the squares our own pawn would capture on
+    uint64_t pawnCheckMask = shift<Side<Us>::UpLeft>(kingBB & ~fileConst[0]) | shift<Side<Us>::UpRight>(kingBB & ~fileConst[7]);
+    info.checkers |= pawnCheckMask & pieceBitboards[Side<Them>::Pawn];
 
     // Check for knight attacks
-    uint64_t knight_attacks = knightPseudoAttacks[kingSquare];                    // Get knight attacks from king square
-    uint64_t enemy_knights = (whiteTurn ? pieceBitboards[8] : pieceBitboards[2]); // Get enemy knights
-    info.checkers |= knight_attacks & enemy_knights;
+    uint64_t knight_attacks = knightPseudoAttacks[kingSquare]; // Get knight attacks from king square
+    info.checkers |= knight_attacks & pieceBitboards[Side<Them>::Knight];
 
     // Check for sliding piece attacks (rooks, bishops, queens)
-    // ... similar to pin detection but simpler
-    // Get the rays in all directions from the king square
+    // A slider gives check exactly when it is hit by the same slider type placed on the king square
     uint64_t occupied = occupiedBitboard;
-    // Check for enemy rooks/queens (orthogonal) and bishops/queens (diagonal)
-    uint64_t enemy_sliding_ortho_pieces = (whiteTurn ? (pieceBitboards[7] | pieceBitboards[10]) :          // Black rooks/queens
-                                               (pieceBitboards[1] | pieceBitboards[4]));                   // White rooks/queens
-    for (int dir = static_cast<int>(Direction::North); dir <= static_cast<int>(Direction::West); dir += 2) // Only go for orthogonal
-    {
-        uint64_t ray;
-        if (dir < 4)
-        { // Positive Rays
-            ray = getPositiveRayAttacks(occupied, static_cast<Direction>(dir), kingSquare);
-        }
-        else
-        {
-            ray = getNegativeRayAttacks(occupied, static_cast<Direction>(dir), kingSquare);
-        }
-        if (ray == 0)
-            continue; // No ray in this direction
-
-        uint64_t sliding_checkers = ray & enemy_sliding_ortho_pieces;
-        if (sliding_checkers)
-        {
-            info.checkers |= sliding_checkers;
-        }
-    }
-
-    uint64_t enemy_sliding_diag_pieces = (whiteTurn ? (pieceBitboards[9] | pieceBitboards[10]) :               // Black bishops/queens
-                                              (pieceBitboards[3] | pieceBitboards[4]));                        // White bishops/queens
-    for (int dir = static_cast<int>(Direction::NorthWest); dir <= static_cast<int>(Direction::West); dir += 2) // Only go for diagonals
-    {
-        uint64_t ray;
-        if (dir < 4)
-        { // Positive Rays
-            ray = getPositiveRayAttacks(occupied, static_cast<Direction>(dir), kingSquare);
-        }
-        else
-        {
-            ray = getNegativeRayAttacks(occupied, static_cast<Direction>(dir), kingSquare);
-        }
-        if (ray == 0)
-            continue; // No ray in this direction
+    uint64_t enemy_sliding_ortho_pieces = pieceBitboards[Side<Them>::Rook] | pieceBitboards[Side<Them>::Queen];
+    info.checkers |= getRookAttacks(occupied, kingSquare) & enemy_sliding_ortho_pieces;
 
-        uint64_t sliding_checkers = ray & enemy_sliding_diag_pieces;
-        if (sliding_checkers)
-        {
-            info.checkers |= sliding_checkers;
-        }
-    }
+    uint64_t enemy_sliding_diag_pieces = pieceBitboards[Side<Them>::Bishop] | pieceBitboards[Side<Them>::Queen];
+    info.checkers |= getBishopAttacks(occupied, kingSquare) & enemy_sliding_diag_pieces;
 
     info.isInCheck = info.checkers != 0;
 
@@ -1981,24 +1784,10 @@ CheckInfo ChessGame::calculateCheckInfo()
 
 void ChessGame::bitboardToBoardArray()
 {
-    // Convert the bitboard representation to a 2D array for easier visualization
-    for (int i = 0; i < 8; i++)
+    // Copy the mailbox into the 2D array used for printing
+    for (int sq = 0; sq < 64; sq++)
     {
-        for (int j = 0; j < 8; j++)
-        {
-            boardArray[i][j] = Piece::e; // Initialize the board array with empty squares
-        }
-    }
-    for (int i = 0; i < 12; i++)
-    {
-        uint64_t bitboard = pieceBitboards[i];
-        for (int j = 0; j < 64; j++)
-        {
-            if (bitboard & (1ULL << j))
-            {
-                boardArray[j / 8][j % 8] = static_cast<Piece>(i + 1); // Store the piece type in the board array
-            }
-        }
+        boardArray[sq / 8][sq % 8] = board[sq];
     }
 }
 
@@ -2009,6 +1798,7 @@ bool ChessGame::isSquareAttacked(Square square) const
     return (opponentAttacks & squareBitboard) != 0;
 }
 
+template <Color Us>
 void ChessGame::generateOpponentAttacks() const
 {
     /*
@@ -2020,21 +1810,12 @@ void ChessGame::generateOpponentAttacks() const
     /*New: we only use opponent attacks for excluding illegal king moves. To make
     sure we exclude squares along checking rays, we should calculate opponent
     attacks with the king not on the board.*/
+    constexpr Color Them = Side<Us>::Them;
 
-    uint64_t tempOccupiedBitboard = occupiedBitboard;
-    if (whiteTurn)
-    {
-        // Remove white king from occupied bitboard
-        tempOccupiedBitboard &= ~pieceBitboards[5];
-    }
-    else
-    {
-        // Remove black king from occupied bitboard
-        tempOccupiedBitboard &= ~pieceBitboards[11];
-    }
+    uint64_t tempOccupiedBitboard = occupiedBitboard & ~pieceBitboards[Side<Us>::King]; // Remove our king from occupied bitboard
 
     // Knight Attacks
-    uint64_t knightBitboard = pieceBitboards[whiteTurn ? 8 : 2]; // Assuming 8 is the index for black knights and 2 for white knights
+    uint64_t knightBitboard = pieceBitboards[Side<Them>::Knight];
     int knightSq;
     while (knightBitboard)
     {
@@ -2043,7 +1824,7 @@ void ChessGame::generateOpponentAttacks() const
     }
 
     // Rook Attacks
-    uint64_t rookBitboard = pieceBitboards[whiteTurn ? 7 : 1]; // Assuming 7 is the index for black rooks and 1 for white rooks
+    uint64_t rookBitboard = pieceBitboards[Side<Them>::Rook];
     int rookSq;
     while (rookBitboard)
     {
@@ -2053,7 +1834,7 @@ void ChessGame::generateOpponentAttacks() const
     }
 
     // Bishop Attacks
-    uint64_t bishopBitboard = pieceBitboards[whiteTurn ? 9 : 3]; // Assuming 9 is the index for black bishops and 3 for white bishops
+    uint64_t bishopBitboard = pieceBitboards[Side<Them>::Bishop];
     int bishopSq;
     while (bishopBitboard)
     {
@@ -2063,7 +1844,7 @@ void ChessGame::generateOpponentAttacks() const
     }
 
     // Queen Attacks
-    uint64_t queenBitboard = pieceBitboards[whiteTurn ? 10 : 4]; // Assuming 10 is the index for black queens and 4 for white queens
+    uint64_t queenBitboard = pieceBitboards[Side<Them>::Queen];
     int queenSq;
     while (queenBitboard)
     {
@@ -2073,35 +1854,11 @@ void ChessGame::generateOpponentAttacks() const
     }
 
     // King Attacks
-    uint64_t kingBitboard = pieceBitboards[whiteTurn ? 11 : 5]; // Assuming 11 is the index for black kings and 5 for white kings
-    int kingSq;
-    while (kingBitboard)
-    {
-        kingSq = pop_lsb(kingBitboard); // Get the least significant bit (first king)
-        uint64_t attacks = kingPseudoAttacks[kingSq];
-        opponentAttacks |= attacks; // Add king attacks to opponent attacks
-    }
+    opponentAttacks |= kingPseudoAttacks[__builtin_ctzll(pieceBitboards[Side<Them>::King])];
 
     // Pawn Attacks
-    uint64_t pawnBitboard = pieceBitboards[whiteTurn ? 6 : 0]; // Assuming 6 is the index for black pawns and 0 for white pawns
-    uint64_t leftPawnAttacks;
-    uint64_t rightPawnAttacks;
-    if (whiteTurn)
-    {
-        // Calculate for black pawns attacking white squares
-        leftPawnAttacks = (pawnBitboard & ~fileConst[0]) >> 9;  // Left attacks
-        rightPawnAttacks = (pawnBitboard & ~fileConst[7]) >> 7; // Right attacks
-    }
-    else
-    {
-        // Calculate for white pawns attacking black squares
-        leftPawnAttacks = (pawnBitboard & ~fileConst[0]) << 7;  // Left attacks
-        rightPawnAttacks = (pawnBitboard & ~fileConst[7]) << 9; // Right attacks
-    }
-    // Combine pawn attacks
-    opponentAttacks |= leftPawnAttacks | rightPawnAttacks;
-
-    return;
+    uint64_t pawnBitboard = pieceBitboards[Side<Them>::Pawn];
+    opponentAttacks |= shift<Side<Them>::UpLeft>(pawnBitboard & ~fileConst[0]) | shift<Side<Them>::UpRight>(pawnBitboard & ~fileConst[7]);
 }
 
 void ChessGame::undoMove(const ChessGame::Move &move)
@@ -2111,13 +1868,13 @@ void ChessGame::undoMove(const ChessGame::Move &move)
     // For example, you might have a stack of previous states to pop from
     // or you might need to restore specific piece positions based on the move
     // For now, this is just a placeholder function
-    // std::cout << "Undoing move from " << getSquareName(move.from) << " to " << getSquareName(move.to) << std::endl;
+    // std::cout << "Undoing move from " << getSquareName(move.from()) << " to " << getSquareName(move.to()) << std::endl;
 
-    uint64_t fromBB = 1ULL << static_cast<int>(move.from);
-    uint64_t toBB = 1ULL << static_cast<int>(move.to);
+    int from = static_cast<int>(move.from());
+    int to = static_cast<int>(move.to());
 
     // Find piece at square
-    Piece piece = getPieceAtSquareFromBB(move.to);
+    Piece piece = board[to];
     if (piece == Piece::e)
     {
         std::cerr << "No piece at dest square." << std::endl;
@@ -2125,60 +1882,56 @@ void ChessGame::undoMove(const ChessGame::Move &move)
     }
 
     // Remove piece from dest square
-    pieceBitboards[static_cast<int>(piece) - 1] &= ~toBB;
+    removePiece(to);
 
-    if (move.isEnPassant)
+    if (move.isEnPassant())
     {
-        Piece capturedPiece = currentState->capturedPiece;
+        Piece capturedPiece = currentState()->capturedPiece;
         if (capturedPiece != Piece::e)
         {
-            pieceBitboards[static_cast<int>(capturedPiece) - 1] |= !whiteTurn ? (toBB >> 8) : (toBB << 8);
+            putPiece(capturedPiece, !whiteTurn ? to - 8 : to + 8);
         }
     }
-    else if (move.isCapture)
+    else if (move.isCapture())
     {
-        // If it's a capture, remove the captured piece from its bitboard
-        Piece capturedPiece = currentState->capturedPiece;
+        // If it's a capture, put the captured piece back
+        Piece capturedPiece = currentState()->capturedPiece;
         if (capturedPiece != Piece::e)
         {
-            pieceBitboards[static_cast<int>(capturedPiece) - 1] |= toBB;
+            putPiece(capturedPiece, to);
         }
     }
 
-    if (move.isPromotion)
+    if (move.isPromotion())
     {
         // Add pawn back to source square
-        pieceBitboards[static_cast<int>(whiteTurn ? Piece::P : Piece::p) - 1] |= fromBB;
+        putPiece(whiteTurn ? Piece::P : Piece::p, from);
     }
     else
     {
         // Add piece back to source square
-        pieceBitboards[static_cast<int>(piece) - 1] |= fromBB;
+        putPiece(piece, from);
     }
 
-    if (move.isCastling)
+    if (move.isCastling())
     {
-        switch (move.to)
+        switch (move.to())
         {
         case Square::g1:
             // Kingside castling for white
-            pieceBitboards[static_cast<int>(Piece::r) - 1] &= ~(1ULL << static_cast<int>(Square::f1)); // Remove rook from f1
-            pieceBitboards[static_cast<int>(Piece::r) - 1] |= (1ULL << static_cast<int>(Square::h1));  // Place rook on h1
+            movePiece(static_cast<int>(Square::f1), static_cast<int>(Square::h1)); // Rook f1 -> h1
             break;
         case Square::c1:
             // Queenside castling for white
-            pieceBitboards[static_cast<int>(Piece::r) - 1] &= ~(1ULL << static_cast<int>(Square::d1)); // Remove rook from d1
-            pieceBitboards[static_cast<int>(Piece::r) - 1] |= (1ULL << static_cast<int>(Square::a1));  // Place rook on a1
+            movePiece(static_cast<int>(Square::d1), static_cast<int>(Square::a1)); // Rook d1 -> a1
             break;
         case Square::g8:
             // Kingside castling for black
-            pieceBitboards[static_cast<int>(Piece::R) - 1] &= ~(1ULL << static_cast<int>(Square::f8)); // Remove rook from f8
-            pieceBitboards[static_cast<int>(Piece::R) - 1] |= (1ULL << static_cast<int>(Square::h8));  // Place rook on h8
+            movePiece(static_cast<int>(Square::f8), static_cast<int>(Square::h8)); // Rook f8 -> h8
             break;
         case Square::c8:
             // Queenside castling for black
-            pieceBitboards[static_cast<int>(Piece::R) - 1] &= ~(1ULL << static_cast<int>(Square::d8)); // Remove rook from d8
-            pieceBitboards[static_cast<int>(Piece::R) - 1] |= (1ULL << static_cast<int>(Square::a8));  // Place rook on a8
+            movePiece(static_cast<int>(Square::d8), static_cast<int>(Square::a8)); // Rook d8 -> a8
             break;
 
         default:
@@ -2190,22 +1943,18 @@ void ChessGame::undoMove(const ChessGame::Move &move)
 
     gameOver = false; // Reset game over state
 
-    movesPlayed.pop_back(); // Remove the last move from the history
-
-    StateInfo *oldState = currentState; // Save the current state before moving back
-
-    currentState = currentState->previousState; // Move back to the previous state
-    // Castling rights and en passant target square should be restored from the previous state
-
-    // Free the old state
-    delete oldState;
+    stateIndex--; // Pop back to the previous state, its castling rights and en passant square are untouched
 
-    checkInfoStruct = currentState->checkInfo; // Restore check info
-    pinInfoStruct = currentState->pinInfo;     // Restore pin info
-
-    whitePieces = pieceBitboards[0] | pieceBitboards[1] | pieceBitboards[2] | pieceBitboards[3] | pieceBitboards[4] | pieceBitboards[5];
-    blackPieces = pieceBitboards[6] | pieceBitboards[7] | pieceBitboards[8] | pieceBitboards[9] | pieceBitboards[10] | pieceBitboards[11];
-    occupiedBitboard = whitePieces | blackPieces;
-    emptyBitboard = ~occupiedBitboard;
+    updateOccupancy();
+    invalidatePositionInfo();
     return;
-}
\ No newline at end of file
+}
+
+// The passes below are otherwise only instantiated inside this file; the
+// microbenchmarks in bench/ call them directly
+template PinInfo ChessGame::calculatePins<Color::White>(uint64_t) const;
+template PinInfo ChessGame::calculatePins<Color::Black>(uint64_t) const;
+template CheckInfo ChessGame::calculateCheckInfo<Color::White>() const;
+template CheckInfo ChessGame::calculateCheckInfo<Color::Black>() const;
+template void ChessGame::generateOpponentAttacks<Color::White>() const;
+template void ChessGame::generateOpponentAttacks<Color::Black>() const;
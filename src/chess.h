@@ -5,6 +5,9 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <cstdint>
+
+#include "./attacks.h"
 
 enum class Piece : uint8_t
 {
@@ -23,6 +26,12 @@ enum class Piece : uint8_t
     K, // black king
 };
 
+enum class Color : uint8_t
+{
+    White,
+    Black,
+};
+
 enum class Square : uint8_t
 {
     a1,
@@ -105,8 +114,7 @@ enum class Direction : uint8_t // Start at NW and go clockwise
 
 struct PinInfo
 {
-    uint64_t pinned_pieces;
-    uint64_t pin_rays[64]; // Ray from king through pinned piece
+    uint64_t pinned_pieces; // A pinned piece may only move along pinLine(square)
 };
 
 struct CheckInfo
@@ -118,42 +126,108 @@ struct CheckInfo
 
 struct StateInfo
 {
-    PinInfo pinInfo;     // Information about pinned pieces
-    CheckInfo checkInfo; // Information about checks
-    StateInfo *previousState;
     Piece capturedPiece;                 // Piece that was captured in the last move
     Square enPassantSquare = Square::a1; // Square that was en passant captured
     char castlingRights;                 // Let's just represent this with the 4 least sign bits of a char
                                          // 1111 = KQkq
+    uint64_t key = 0;                    // Zobrist hash of the position, see zobrist.h
+    int material = 0;                    // Sum of PSQT::material over the pieces on the board
+    int pieceSquare = 0;                 // Sum of PSQT::tables.pieceSquare over the pieces on the board
 };
 
 class ChessGame
 {
 public:
+    // Move packed into 16 bits: from (bits 0-5), to (bits 6-11) and a 4 bit
+    // flag (bits 12-15) describing the move kind and the promotion piece.
     struct Move
     {
-        Square from;
-        Square to;
-        Piece promotionPiece = Piece::e; // Promotion piece, default to empty
-        bool isPromotion = false;        // Default to false
-        bool isCapture = false;          // Default to false
-        bool isEnPassant = false;        // Default to false
-        bool isCastling = false;         // Default to false
-
-        bool operator==(const Move &other) const
+        enum Flags : uint8_t
+        {
+            Quiet = 0,
+            DoublePawnPush = 1,
+            KingCastle = 2,
+            QueenCastle = 3,
+            Capture = 4,     // Bit set for every capture, including promotion captures
+            EnPassant = 5,
+            Promotion = 8,   // Bit set for every promotion, low two bits: 0 = N, 1 = B, 2 = R, 3 = Q
+        };
+
+        uint16_t data;
+
+        Move() = default; // Trivial so move lists are not initialized; Move{} is the null move (a1a1)
+        constexpr Move(Square from, Square to, uint8_t flags = Quiet)
+            : data(static_cast<uint16_t>(static_cast<int>(from) | (static_cast<int>(to) << 6) | (flags << 12))) {}
+
+        Square from() const { return static_cast<Square>(data & 0x3F); }
+        Square to() const { return static_cast<Square>((data >> 6) & 0x3F); }
+        uint8_t flags() const { return data >> 12; }
+
+        bool isCapture() const { return data & (Capture << 12); }
+        bool isPromotion() const { return data & (Promotion << 12); }
+        bool isEnPassant() const { return flags() == EnPassant; }
+        bool isCastling() const { return flags() == KingCastle || flags() == QueenCastle; }
+        bool isDoublePawnPush() const { return flags() == DoublePawnPush; }
+
+        // Promotion piece using the black piece letters (Piece::N/B/R/Q), Piece::e if not a promotion
+        Piece promotionPiece() const
         {
-            return from == other.from &&
-                   to == other.to &&
-                   isCapture == other.isCapture &&
-                   isCastling == other.isCastling &&
-                   promotionPiece == other.promotionPiece;
+            static constexpr Piece promotionPieces[4] = {Piece::N, Piece::B, Piece::R, Piece::Q};
+            return isPromotion() ? promotionPieces[flags() & 3] : Piece::e;
+        }
+
+        static constexpr uint8_t promotionFlags(Piece promotionPiece, bool isCapture)
+        {
+            uint8_t flags = Promotion | (isCapture ? Capture : 0);
+            switch (promotionPiece)
+            {
+            case Piece::B:
+            case Piece::b:
+                return flags | 1;
+            case Piece::R:
+            case Piece::r:
+                return flags | 2;
+            case Piece::Q:
+            case Piece::q:
+                return flags | 3;
+            default:
+                return flags; // Knight
+            }
         }
+
+        bool operator==(const Move &other) const { return data == other.data; }
+        bool operator!=(const Move &other) const { return data != other.data; }
+    };
+    static_assert(sizeof(Move) == 2, "Move must stay packed into 16 bits");
+
+    // Fixed-capacity move list that lives on the caller's stack, so move
+    // generation never touches the allocator. No legal chess position has
+    // more than 218 moves.
+    struct MoveList
+    {
+        static constexpr int MAX_MOVES = 256;
+
+        Move moves[MAX_MOVES];
+        int count = 0;
+
+        void push_back(const Move &move) { moves[count++] = move; }
+        void clear() { count = 0; }
+        int size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        Move &operator[](int i) { return moves[i]; }
+        const Move &operator[](int i) const { return moves[i]; }
+
+        Move *begin() { return moves; }
+        Move *end() { return moves + count; }
+        const Move *begin() const { return moves; }
+        const Move *end() const { return moves + count; }
     };
 
     ChessGame();
     void printBoard(bool withBitboards);
     bool makeMove(const std::string &move);
-    bool isGameOver() const;
+    bool isGameOver() const; // As of the last preworkPosition(); searches test for an empty move list instead
     bool isWhiteWins() const
     {
         return whiteWins;
@@ -161,9 +235,50 @@ public:
     void parseFEN(const std::string &fen);
     std::string generateFEN();
 
-    std::vector<Move> generateMoves() const;
+    // Which legal moves a generator call writes
+    enum class GenType : uint8_t
+    {
+        Captures, // Captures, en passant and every promotion
+        Quiets,   // All other moves, castling included
+        All,
+    };
+
+    void generateMoves(MoveList &moves) const; // Writes all legal moves for the side to move into moves
+    void generateCaptures(MoveList &moves) const; // Only GenType::Captures moves, for quiescence and staged picking
+    void generateQuiets(MoveList &moves) const;   // The legal moves generateCaptures leaves out
+
+    // Like generateMoves() without the pin and king-safety filtering: checks are
+    // still evaded, but every move must pass isLegal() before it is applied
+    void generatePseudoLegalMoves(MoveList &moves, GenType type = GenType::All) const;
+    bool isLegal(const Move &move) const; // Only for moves generated in the current position
+    // Whether generatePseudoLegalMoves() would write `move` here, without generating anything;
+    // for hash moves and killers that come from other positions
+    bool isPseudoLegal(const Move &move) const;
+
+    // Number of legal moves, counted with popcounts over the same target sets
+    // generateMoves() uses, without writing any Move
+    int countLegalMoves() const;
+
+    // Pieces of both colours attacking `square` when the board holds `occupied`
+    uint64_t attackersTo(int square, uint64_t occupied) const;
+    uint64_t attackersTo(int square) const { return attackersTo(square, occupiedBitboard); }
+
+    // Static exchange evaluation of a move of the side to move: the material it
+    // wins (negative if it loses material) when both sides keep recapturing on
+    // the target square with their cheapest piece and may stop at any point.
+    // Pins are ignored and recapturing pawns do not promote.
+    int see(const Move &move) const;
+    // see(move) >= threshold, stopping as soon as the outcome is settled
+    bool seeGE(const Move &move, int threshold = 0) const;
+    // Piece values used by the exchange, by bitboard index modulo 6 (p, r, n, b, q, k)
+    static constexpr int seeValues[6] = {100, 500, 320, 330, 900, 20000};
+    // seeValues entry of a piece of either colour; also the MVV-LVA values of MovePicker
+    static constexpr int pieceValue(Piece piece)
+    {
+        return seeValues[(static_cast<int>(piece) - 1) % 6];
+    }
 
-    void addMovesFromBitboard(std::vector<Move> &moves, uint64_t moveBitboard,
+    void addMovesFromBitboard(MoveList &moves, uint64_t moveBitboard,
                               int pieceType, int offsetForSource) const;
 
     static int parseSquare(const std::string &squareString);
@@ -176,9 +291,28 @@ public:
     {
         return whiteTurn;
     }
+
+    // Zobrist hash, kept up to date by applyMove and restored for free by undoMove
+    uint64_t getZobristKey() const
+    {
+        return currentState()->key;
+    }
+    uint64_t computeZobristKey() const; // From scratch, for checking the incremental key
+
+    // Evaluation terms from white's point of view, kept up to date the same way as the key
+    int getMaterialScore() const
+    {
+        return currentState()->material;
+    }
+    int getPieceSquareScore() const
+    {
+        return currentState()->pieceSquare;
+    }
+    int computeMaterialScore() const;    // From scratch, like computeZobristKey()
+    int computePieceSquareScore() const;
     void printBoardWithMovesByPiece(Square square) const;
     static std::string getSquareName(Square square);
-    void preworkPosition();
+    void preworkPosition(); // Computes check, pin and game-over info and fills getMovesVector()
 
     void undoMove(const Move &move);
 
@@ -187,47 +321,51 @@ public:
         return pieceBitboards;
     }
 
-    void applyMove(const Move &move);
+    void applyMove(const Move &move); // Only updates the board and StateInfo, see preworkPosition()
 
-    std::vector<Move> movesPlayed; // Vector to hold all moves in the game
+    // Moves applied since the last parseFEN(); lastMove() needs movesPlayedCount() > 0
+    size_t movesPlayedCount() const { return stateIndex; }
+    Move lastMove() const { return movesPlayed[stateIndex]; }
 
-    std::vector<Move> getMovesVector() const
+    // Legal moves as of the last preworkPosition() (parseFEN, makeMove); applyMove leaves it alone
+    const MoveList &getMovesVector() const
     {
         return movesVector;
     }
 
+    bool isInCheck() const
+    {
+        ensurePositionInfo();
+        return checkInfoStruct.isInCheck;
+    }
+
     int getGameResult() const
     {
         return gameResult;
     }
 
-    Piece getPieceAtSquareFromBB(Square square) const;
+    Piece getPieceAtSquare(Square square) const
+    {
+        return board[static_cast<int>(square)];
+    }
 
+    // Converts a move to UCI notation, e.g. e2e4 or e7e8q
     static std::string moveToString(const Move &move)
     {
-        std::string moveStr = getSquareName(move.from) + getSquareName(move.to);
-        if (move.isPromotion)
+        std::string moveStr = getSquareName(move.from()) + getSquareName(move.to());
+        if (move.isPromotion())
         {
-            switch (move.promotionPiece)
-            {
-            case Piece::Q:
-                moveStr += "q";
-                break;
-            case Piece::R:
-                moveStr += "r";
-                break;
-            case Piece::B:
-                moveStr += "b";
-                break;
-            case Piece::N:
-                moveStr += "n";
-                break;
-            }
+            moveStr += "nbrq"[move.flags() & 3];
         }
         return moveStr;
     }
 
+    // Finds the legal move matching a UCI string, returns Move{} if there is none
+    Move moveFromString(const std::string &moveStr) const;
+
 private:
+    friend class MicroBench; // bench/microbench.cpp times the private pin, check and attack passes
+
     // TODO: Define your board representation here (e.g., array or vector)
     // For simplicity, we can use a 2D vector of small ints to represent the board
 
@@ -253,6 +391,30 @@ private:
         {Piece::P, Piece::P, Piece::P, Piece::P, Piece::P, Piece::P, Piece::P, Piece::P},
         {Piece::R, Piece::N, Piece::B, Piece::Q, Piece::K, Piece::B, Piece::N, Piece::R}};
 
+    // Mailbox kept in sync with the bitboards by putPiece/removePiece/movePiece,
+    // so finding the piece on a square is a single load
+    Piece board[64] = {};
+
+    void putPiece(Piece piece, int sq)
+    {
+        pieceBitboards[static_cast<int>(piece) - 1] |= 1ULL << sq;
+        board[sq] = piece;
+    }
+
+    void removePiece(int sq)
+    {
+        pieceBitboards[static_cast<int>(board[sq]) - 1] &= ~(1ULL << sq);
+        board[sq] = Piece::e;
+    }
+
+    void movePiece(int from, int to)
+    {
+        Piece piece = board[from];
+        pieceBitboards[static_cast<int>(piece) - 1] ^= (1ULL << from) | (1ULL << to);
+        board[from] = Piece::e;
+        board[to] = piece;
+    }
+
     // Bitboards
     uint64_t pieceBitboards[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}; // prnbqkPRNBQK
     uint64_t whitePieces = 0;                                           // Bitboard for all white pieces
@@ -273,17 +435,17 @@ private:
     bool whiteWins = false; // Flag to indicate if white has won
 
     // Set up constants for the bitboard representation
-    uint64_t rankConst[8] = {
+    static constexpr uint64_t rankConst[8] = {
         0x00000000000000FF,
         0x000000000000FF00,
         0x0000000000FF0000,
         0x00000000FF000000,
         0x000000FF00000000,
         0x0000FF0000000000,
-        0x00F0000000000000,
+        0x00FF000000000000,
         0xFF00000000000000};
 
-    uint64_t fileConst[8] = {
+    static constexpr uint64_t fileConst[8] = {
         0x0101010101010101,
         0x0202020202020202,
         0x0404040404040404,
@@ -293,15 +455,11 @@ private:
         0x4040404040404040,
         0x8080808080808080};
 
-    // Precomputed attack bitboards
-
-    uint64_t knightPseudoAttacks[64];
-    void initializeKnightAttacks();
+    // Precomputed attack bitboards, generated at compile time and shared by every game
 
-    uint64_t kingPseudoAttacks[64];
-    void initializeKingAttacks();
+    static constexpr std::array<uint64_t, 64> knightPseudoAttacks = Attacks::makeKnightAttacks();
 
-    Move getMove(const ChessGame::Move &move) const;
+    static constexpr std::array<uint64_t, 64> kingPseudoAttacks = Attacks::makeKingAttacks();
 
     void resetBoard();
 
@@ -313,8 +471,9 @@ private:
 
     void printBitboard(uint64_t bitboard) const;
 
-    uint64_t rayAttacks[64][8] = {}; // Precomputed ray attacks for sliding pieces
-    void initializeRayAttacks();
+    static constexpr std::array<std::array<uint64_t, 8>, 64> rayAttacks = Attacks::makeRayAttacks(); // Precomputed ray attacks for sliding pieces
+    static constexpr std::array<std::array<uint64_t, 64>, 64> betweenSquares = Attacks::makeBetweenTable();
+    static constexpr std::array<std::array<uint64_t, 64>, 64> lineSquares = Attacks::makeLineTable();
     uint64_t getPositiveRayAttacks(uint64_t occupied, Direction dir8, unsigned long square) const;
     uint64_t getNegativeRayAttacks(uint64_t occupied, Direction dir8, unsigned long square) const;
 
@@ -342,37 +501,166 @@ private:
     uint64_t getRookAttacks(uint64_t occ, int sq) const;
     uint64_t getQueenAttacks(uint64_t occ, int sq) const;
 
-    bool isMoveLegal(const Move &move) const;
+    // Pins and checks of the current position. applyMove and undoMove only
+    // invalidate them; the first query at a node (usually generateMoves)
+    // computes them, so positions that are never expanded never pay for it.
+    mutable PinInfo pinInfoStruct = {};
+    mutable CheckInfo checkInfoStruct = {};
+    mutable bool positionInfoValid = false;
+    mutable bool opponentAttacksValid = false; // Only legal generation needs them
+
+    void ensurePositionInfo() const;
+    void ensureOpponentAttacks() const;
+    void invalidatePositionInfo()
+    {
+        positionInfoValid = false;
+        opponentAttacksValid = false;
+    }
+
+    template <Color Us>
+    bool isLegalFor(const Move &move) const;
+    template <Color Us>
+    bool isPseudoLegalFor(const Move &move) const;
+
+    // Exchange helpers for see()/seeGE(): the value the move gains before any recapture,
+    // and the value of the piece left standing on the target square
+    int seeCaptureGain(const Move &move) const;
+    int seeMovedValue(const Move &move) const;
+    // Takes the cheapest of `candidates` off `occupied`, adds the sliders it uncovered
+    // to `attackers` and returns its bitboard index modulo 6, or -1 if there is none
+    int popLeastValuableAttacker(uint64_t candidates, int square, uint64_t &occupied, uint64_t &attackers) const;
+
+    // Squares attacked by pawns of colour C standing on `pawns`
+    template <Color C>
+    static uint64_t pawnAttacks(uint64_t pawns)
+    {
+        return shift<Side<C>::UpLeft>(pawns & ~fileConst[0]) | shift<Side<C>::UpRight>(pawns & ~fileConst[7]);
+    }
+    template <Color Us>
+    void updatePositionInfo() const;
+
+    void updateOccupancy()
+    {
+        whitePieces = pieceBitboards[0] | pieceBitboards[1] | pieceBitboards[2] | pieceBitboards[3] | pieceBitboards[4] | pieceBitboards[5];
+        blackPieces = pieceBitboards[6] | pieceBitboards[7] | pieceBitboards[8] | pieceBitboards[9] | pieceBitboards[10] | pieceBitboards[11];
+        occupiedBitboard = whitePieces | blackPieces;
+        emptyBitboard = ~occupiedBitboard;
+    }
+
+    template <Color Us>
+    PinInfo calculatePins(uint64_t enemy_pieces) const; // enemy_pieces: the blockers to look through
+
+    // Squares between two aligned squares, including `to`; 0 when they are not aligned
+    uint64_t getRayBetween(int from, int to) const
+    {
+        return betweenSquares[from][to];
+    }
+
+    // Full line through our king and a pinned piece on `square`
+    uint64_t pinLine(int square) const
+    {
+        return lineSquares[__builtin_ctzll(pieceBitboards[whiteTurn ? 5 : 11])][square];
+    }
 
-    PinInfo pinInfoStruct = {};     // Struct to hold pin information
-    CheckInfo checkInfoStruct = {}; // Struct to hold check information
+    template <Color Us>
+    CheckInfo calculateCheckInfo() const;
 
-    PinInfo calculatePins(uint64_t enemy_pieces, bool is_white) const;
+    MoveList movesVector; // Legal moves of the current position, filled by preworkPosition and makeMove
 
-    uint64_t getRayBetween(int from, int to) const;
+    // Compile-time constants for the generators below, which are templated on
+    // the side to move so that indices, shifts and ranks fold into the code
+    template <Color C>
+    struct Side
+    {
+        static constexpr Color Them = C == Color::White ? Color::Black : Color::White;
+        static constexpr int Pawn = C == Color::White ? 0 : 6; // Indices into pieceBitboards
+        static constexpr int Rook = Pawn + 1;
+        static constexpr int Knight = Pawn + 2;
+        static constexpr int Bishop = Pawn + 3;
+        static constexpr int Queen = Pawn + 4;
+        static constexpr int King = Pawn + 5;
+        static constexpr int Up = C == Color::White ? 8 : -8; // Square offsets of pawn pushes and captures
+        static constexpr int UpLeft = C == Color::White ? 7 : -9;
+        static constexpr int UpRight = C == Color::White ? 9 : -7;
+    };
 
-    CheckInfo calculateCheckInfo();
+    template <int Offset>
+    static constexpr uint64_t shift(uint64_t bb)
+    {
+        if constexpr (Offset > 0)
+            return bb << Offset;
+        else
+            return bb >> -Offset;
+    }
 
-    mutable std::vector<Move> movesVector;
+    template <Color C>
+    uint64_t piecesOf() const
+    {
+        return C == Color::White ? whitePieces : blackPieces;
+    }
 
-    void generatePawnMoves(std::vector<Move> &moves) const;
-    void generateKnightMoves(std::vector<Move> &moves) const;
-    void generateBishopMoves(std::vector<Move> &moves) const;
-    void generateRookMoves(std::vector<Move> &moves) const;
-    void generateQueenMoves(std::vector<Move> &moves) const;
-    void generateKingMoves(std::vector<Move> &moves) const;
-    void generateCastlingMoves(std::vector<Move> &moves) const;
+    void generateMoves(MoveList &moves, GenType type, bool legal) const;
+
+    template <Color Us>
+    void generateMovesFor(MoveList &moves, GenType type, bool legal) const;
+
+    // Piece generators only emit moves landing on `targets` (enemy pieces, empty squares or both).
+    // With legal == false pinned pieces move freely and the king ignores attacked squares.
+    template <Color Us>
+    void generatePawnMoves(MoveList &moves, GenType type, bool legal) const;
+    template <Color Us>
+    void generatePawnMovesFrom(MoveList &moves, uint64_t pawns, uint64_t allowed, GenType type) const; // allowed: check and pin mask
+    void addPawnMoves(MoveList &moves, uint64_t targets, int offset, uint8_t flags) const;                // offset: to - from
+    void addPawnPromotions(MoveList &moves, uint64_t targets, int offset, bool capture) const;
+    template <Color Us>
+    void generateKnightMoves(MoveList &moves, uint64_t targets, bool legal) const;
+    template <Color Us>
+    void generateBishopMoves(MoveList &moves, uint64_t targets, bool legal) const;
+    template <Color Us>
+    void generateRookMoves(MoveList &moves, uint64_t targets, bool legal) const;
+    template <Color Us>
+    void generateQueenMoves(MoveList &moves, uint64_t targets, bool legal) const;
+    template <Color Us>
+    void generateKingMoves(MoveList &moves, uint64_t targets, bool legal) const;
+    template <Color Us>
+    void generateCastlingMoves(MoveList &moves, bool legal) const;
+
+    // Shared by the generators and countLegalMoves()
+    template <Color Us>
+    uint64_t enPassantCapturers(bool legal) const; // Our pawns that may capture en passant
+    template <Color Us>
+    int castlingSides(bool legal) const; // Bit 0: king side, bit 1: queen side
+
+    template <Color Us>
+    int countMovesFor() const;
+    template <Color Us>
+    int countPawnMovesFrom(uint64_t pawns, uint64_t allowed) const;
 
     mutable uint64_t opponentAttacks; // Attacks that can specifically attack the king
 
     bool isSquareAttacked(Square square) const;
 
-    void generateOpponentAttacks() const;
+    template <Color Us>
+    void generateOpponentAttacks() const; // Attacks of the side not to move, computed without our king
 
-    StateInfo *currentState = nullptr; // Pointer to the current state info
+    // States for every ply of the game and the search, indexed by ply. Make and
+    // unmake just move stateIndex, so copies of a game are fully independent.
+    // The stacks start small, which keeps constructing and copying a game cheap,
+    // and double the first time a line outgrows them.
+    static constexpr size_t INITIAL_STACK_PLY = 64;
+    std::vector<StateInfo> stateStack;
+    std::vector<Move> movesPlayed; // movesPlayed[i] is the move that reached stateStack[i]
+    size_t stateIndex = 0;
 
+    StateInfo *currentState() { return &stateStack[stateIndex]; }
+    const StateInfo *currentState() const { return &stateStack[stateIndex]; }
+
+    template <Color Us>
     bool enPassantIsLegal(int pawnSq, int enPassantSq) const;
 
+    // Whether a pawn of the side to move attacks the en passant square; only then is its file hashed
+    bool enPassantHashed(Square enPassantSquare) const;
+
     void bitboardToBoardArray();
 
     int gameResult = 0; // 0 = Draw, 1 = White wins, -1 = Black wins; Given at game over
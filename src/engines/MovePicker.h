@@ -0,0 +1,217 @@
+#ifndef MOVEPICKER_H
+#define MOVEPICKER_H
+
+#include "../chess.h"
+#include <cstdint>
+#include <utility>
+
+// Hands out the moves of a position one at a time in the order a search most
+// likely wants them: the hash move, then captures and promotions (best victim,
+// cheapest attacker first), then the killer moves, then the remaining quiets,
+// and last the captures that static exchange evaluation says lose material.
+// Each stage only runs when the previous one is exhausted, so a search that
+// cuts off on an early move never generates or sorts the rest: the hash move
+// and killers are checked with isPseudoLegal() without generating anything,
+// and quiet moves are only generated once the killers are used up.
+// Moves are generated pseudo-legally and checked with isLegal() only when they
+// are handed out, so moves behind a cutoff are never checked at all.
+class MovePicker
+{
+public:
+  static constexpr int KILLERS = 2;
+
+  // hashMove may be Move{}; killers may be nullptr, otherwise it points to
+  // KILLERS quiet moves that caused cutoffs at this ply in sibling positions.
+  // deferLosingCaptures should be false when the children are only evaluated
+  // statically: no recapture is searched there, so a capture SEE calls losing
+  // is really worth its full victim.
+  MovePicker(const ChessGame &game, ChessGame::Move hashMove, const ChessGame::Move *killers = nullptr,
+             bool deferLosingCaptures = true)
+      : game(game), hashMove(hashMove), deferLosingCaptures(deferLosingCaptures)
+  {
+    for (int i = 0; i < KILLERS; ++i)
+    {
+      this->killers[i] = killers ? killers[i] : ChessGame::Move{};
+    }
+  }
+
+  // Returns the next legal move, or Move{} once every move was returned
+  ChessGame::Move next()
+  {
+    ChessGame::Move move = nextPseudoLegal();
+    while (move != ChessGame::Move{} && !game.isLegal(move))
+    {
+      move = nextPseudoLegal();
+    }
+    return move;
+  }
+
+  // Captures, en passant and promotions: moves that change the material balance
+  static bool isNoisy(const ChessGame::Move &move)
+  {
+    return move.isCapture() || move.isPromotion();
+  }
+
+private:
+  ChessGame::Move nextPseudoLegal()
+  {
+    switch (stage)
+    {
+    case Stage::HashMove:
+      stage = Stage::GenerateNoisy;
+      if (hashMove != ChessGame::Move{} && game.isPseudoLegal(hashMove))
+      {
+        return hashMove;
+      }
+      [[fallthrough]];
+
+    case Stage::GenerateNoisy:
+      generateNoisy();
+      stage = Stage::Noisy;
+      [[fallthrough]];
+
+    case Stage::Noisy:
+      while (current < noisy.size())
+      {
+        ChessGame::Move move = pickBest();
+        if (move == hashMove)
+          continue;
+        if (deferLosingCaptures && !game.seeGE(move, 0))
+        {
+          badNoisy.push_back(move); // Loses material: try every quiet move first
+          continue;
+        }
+        return move;
+      }
+      stage = Stage::Killers;
+      current = 0;
+      [[fallthrough]];
+
+    case Stage::Killers:
+      while (current < KILLERS)
+      {
+        ChessGame::Move killer = killers[current++];
+        if (killer != ChessGame::Move{} && killer != hashMove && !isNoisy(killer) && game.isPseudoLegal(killer))
+        {
+          return killer;
+        }
+      }
+      generateQuiets();
+      stage = Stage::Quiets;
+      current = 0;
+      [[fallthrough]];
+
+    case Stage::Quiets:
+      while (current < quiets.size())
+      {
+        ChessGame::Move move = quiets[current++];
+        if (move != hashMove && !isKiller(move))
+        {
+          return move;
+        }
+      }
+      stage = Stage::BadNoisy;
+      current = 0;
+      [[fallthrough]];
+
+    case Stage::BadNoisy:
+      if (current < badNoisy.size())
+      {
+        return badNoisy[current++]; // Still in MVV-LVA order
+      }
+      stage = Stage::Done;
+      [[fallthrough]];
+
+    case Stage::Done:
+      break;
+    }
+    return ChessGame::Move{};
+  }
+
+  enum class Stage : uint8_t
+  {
+    HashMove,
+    GenerateNoisy,
+    Noisy,
+    Killers,
+    Quiets,
+    BadNoisy,
+    Done,
+  };
+
+  // Shared with static exchange evaluation, so both order pieces the same way
+  static int valueOf(Piece piece)
+  {
+    return ChessGame::pieceValue(piece);
+  }
+
+  // MVV-LVA: the most valuable victim first, among equal victims the cheapest attacker
+  int score(const ChessGame::Move &move) const
+  {
+    int value = 0;
+    if (move.isCapture())
+    {
+      Piece victim = move.isEnPassant() ? Piece::p : game.getPieceAtSquare(move.to());
+      value += valueOf(victim) * 16 - valueOf(game.getPieceAtSquare(move.from())) / 100;
+    }
+    if (move.isPromotion())
+    {
+      value += valueOf(move.promotionPiece()) * 16;
+    }
+    return value;
+  }
+
+  void generateNoisy()
+  {
+    game.generatePseudoLegalMoves(noisy, ChessGame::GenType::Captures);
+    for (int i = 0; i < noisy.size(); ++i)
+    {
+      noisyScores[i] = score(noisy[i]);
+    }
+  }
+
+  void generateQuiets()
+  {
+    game.generatePseudoLegalMoves(quiets, ChessGame::GenType::Quiets); // Kept in generation order
+  }
+
+  // Selection sort step: swaps the best remaining noisy move to the front and returns it
+  ChessGame::Move pickBest()
+  {
+    int best = current;
+    for (int i = current + 1; i < noisy.size(); ++i)
+    {
+      if (noisyScores[i] > noisyScores[best])
+      {
+        best = i;
+      }
+    }
+    std::swap(noisy[current], noisy[best]);
+    std::swap(noisyScores[current], noisyScores[best]);
+    return noisy[current++];
+  }
+
+  bool isKiller(const ChessGame::Move &move) const
+  {
+    for (int i = 0; i < KILLERS; ++i)
+    {
+      if (killers[i] == move)
+        return true;
+    }
+    return false;
+  }
+
+  const ChessGame &game;
+  ChessGame::Move hashMove;
+  bool deferLosingCaptures;
+  ChessGame::Move killers[KILLERS];
+  Stage stage = Stage::HashMove;
+  int current = 0;
+
+  ChessGame::MoveList noisy;
+  ChessGame::MoveList quiets;
+  ChessGame::MoveList badNoisy; // Noisy moves that failed seeGE(move, 0), in the order they were picked
+  int noisyScores[ChessGame::MoveList::MAX_MOVES];
+};
+
+#endif // MOVEPICKER_H
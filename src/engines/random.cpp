@@ -23,7 +23,8 @@ public:
   {
     srand(time(NULL));
     // Generate all possible moves and return a random one
-    auto moves = this->gamePtr->generateMoves();
+    ChessGame::MoveList moves;
+    this->gamePtr->generateMoves(moves);
     if (moves.empty())
       return ChessGame::Move{}; // Return an empty move if no moves available
 
@@ -1,22 +1,37 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <sstream>
 
 #include "./chess.h"
 #include "./engines/Engine.h"
 #include "./engines/random.cpp"
 #include "./engines/enoki.cpp"
+#include "./engines/bench.h"
 
 // Second argument is the game mode; 0 -> local, 1 -> vs bot
 // Third argument is the color; 0 -> white, 1 -> black; Only used in vs bot mode
+// "bench [depth N] [threads N] [hash MB]" runs the fixed search benchmark instead
 int main(int argc, char *argv[])
 {
     // Check if the first argument is provided
     if (argc < 2)
     {
         std::cerr << "Usage: " << argv[0] << " <game_mode> [<color>]" << std::endl;
+        std::cerr << "       " << argv[0] << " bench [depth N] [threads N] [hash MB]" << std::endl;
         return 1;
     }
+    if (std::string(argv[1]) == "bench")
+    {
+        std::string args;
+        for (int i = 2; i < argc; ++i)
+        {
+            args += std::string(argv[i]) + " ";
+        }
+        std::istringstream in(args);
+        runBench(parseBenchOptions(in), std::cout);
+        return 0;
+    }
     // Check if the first argument is a valid integer
     int game_mode = std::stoi(argv[1]);
     if (game_mode < 0 || game_mode > 1)
@@ -87,8 +102,7 @@ int main(int argc, char *argv[])
             std::cout << "Bot is making a move..." << std::endl;
             // Simulate a random move or a predefined move
             ChessGame::Move moveStruct = engine->getBestMove(5); // Get the best move from the
-            move = ChessGame::getSquareName(moveStruct.from) + ChessGame::getSquareName(moveStruct.to);
-            game.generateMoves(); // Generate moves after the bot's move
+            move = ChessGame::moveToString(moveStruct);
         }
         else
         {
@@ -98,9 +112,9 @@ int main(int argc, char *argv[])
             std::cin >> squareString;
             if (squareString == "undo")
             {
-                if (!game.movesPlayed.empty())
+                if (game.movesPlayedCount() > 0)
                 {
-                    game.undoMove(game.movesPlayed.back());
+                    game.undoMove(game.lastMove());
                     game.printBoard(false);
                     game.preworkPosition();
                     continue;
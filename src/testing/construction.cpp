@@ -0,0 +1,51 @@
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include "../chess.h" // Include your ChessGame header
+
+// Measures what a fresh ChessGame costs. uci.cpp builds a new game on every
+// "position startpos", so both the object size and the constructor matter.
+template <typename Fn>
+double nsPerIteration(int iterations, Fn fn)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < iterations; i++)
+  {
+    fn();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main()
+{
+  const int iterations = 200000;
+  const std::string startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+  volatile int sink = 0;
+
+  {
+    ChessGame warmup; // The first game also builds the process-wide slider tables
+  }
+
+  std::cout << "Chess Engine Construction Benchmark" << std::endl;
+  std::cout << "===================================" << std::endl;
+  std::cout << "sizeof(ChessGame):\t\t" << sizeof(ChessGame) << " bytes" << std::endl;
+
+  double construct = nsPerIteration(iterations, [&]()
+                                    {
+    ChessGame game;
+    sink = sink + game.getCurrentTurn(); });
+
+  double constructAndParse = nsPerIteration(iterations / 10, [&]()
+                                            {
+    ChessGame game;
+    game.parseFEN(startFEN);
+    sink = sink + game.getCurrentTurn(); });
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "ChessGame():\t\t\t" << construct << " ns" << std::endl;
+  std::cout << "ChessGame() + parseFEN:\t\t" << constructAndParse << " ns" << std::endl;
+  return 0;
+}
+
+// Compile with: g++ -std=c++17 -O3 -o construction construction.cpp ../chess.cpp ../attacks.cpp
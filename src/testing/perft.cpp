@@ -1,16 +1,118 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include "../chess.h" // Include your ChessGame header
+#include "../attacks.h"
+
+// Lockless cache of (Zobrist key, depth) -> node count for perft. Each slot
+// stores its key XORed with its data, so a slot torn by two threads writing
+// at once fails verification and reads as a miss. Slots are direct mapped
+// by key and depth and always replaced: perft revisits transpositions close
+// to where they were stored, so the most recent entry is the useful one.
+class PerftHash
+{
+public:
+  explicit PerftHash(size_t megabytes)
+  {
+    size_t wanted = megabytes * 1024 * 1024 / sizeof(Slot);
+    size_t count = 1;
+    while (count * 2 <= wanted)
+    {
+      count *= 2;
+    }
+    slots = std::vector<Slot>(count);
+    mask = count - 1;
+  }
+
+  bool probe(uint64_t key, int depth, uint64_t &nodes) const
+  {
+    const Slot &slot = slots[index(key, depth)];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    // The depth is part of the verified data, so counts of other depths never match
+    if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) != key || (data & 0xFF) != static_cast<uint64_t>(depth))
+    {
+      return false;
+    }
+    nodes = data >> 8;
+    return true;
+  }
+
+  void store(uint64_t key, int depth, uint64_t nodes)
+  {
+    Slot &slot = slots[index(key, depth)];
+    uint64_t data = (nodes << 8) | static_cast<uint64_t>(depth); // Counts stay far below 2^56
+    slot.keyXorData.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<uint64_t> keyXorData{0};
+    std::atomic<uint64_t> data{0}; // Node count (bits 8-63) and depth (bits 0-7); 0 is an empty slot
+  };
+
+  // The same position at different depths lands in different slots
+  size_t index(uint64_t key, int depth) const
+  {
+    return (key ^ (static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15ULL)) & mask;
+  }
+
+  std::vector<Slot> slots;
+  size_t mask = 0;
+};
 
 class PerftTester
 {
 private:
   ChessGame &game;
+  int threads;               // Worker threads used by count(), 1 runs the plain serial perft
+  PerftHash *hash = nullptr; // Shared by every worker when set, see setHash()
+
+  // One unit of parallel work: a root move, optionally followed by one reply
+  struct PerftTask
+  {
+    ChessGame::Move path[2];
+    int length;
+    uint64_t nodes;
+  };
+
+  // Move encodings in ascending order, to compare lists that differ in order only
+  static std::vector<uint16_t> sortedMoves(const ChessGame::MoveList &moves)
+  {
+    std::vector<uint16_t> sorted;
+    for (const auto &move : moves)
+    {
+      sorted.push_back(move.data);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+  }
 
 public:
-  PerftTester(ChessGame &chessGame) : game(chessGame) {}
+  PerftTester(ChessGame &chessGame, int threadCount = 1) : game(chessGame), threads(threadCount < 1 ? 1 : threadCount) {}
+
+  // Caches subtree counts in `perftHash` (nullptr turns caching off); the
+  // table may be shared with other testers and threads
+  void setHash(PerftHash *perftHash)
+  {
+    hash = perftHash;
+  }
+
+  // Perft with the configured number of threads
+  uint64_t count(int depth)
+  {
+    return threads > 1 ? perftParallel(depth) : perft(depth);
+  }
 
   // Core perft function - counts leaf nodes at given depth
   uint64_t perft(int depth)
@@ -20,13 +122,19 @@ public:
       return 1;
     }
 
-    std::vector<ChessGame::Move> moves = game.generateMoves();
+    uint64_t nodes = 0;
+    if (hash && depth >= 2 && hash->probe(game.getZobristKey(), depth, nodes))
+    {
+      return nodes; // Depth 1 is a bulk count, cheaper than a probe
+    }
+
     if (depth == 1)
     {
-      return moves.size(); // At depth 1, just count the moves
+      return game.countLegalMoves(); // At depth 1, just count the moves without generating them
     }
-    uint64_t nodes = 0;
 
+    ChessGame::MoveList moves;
+    game.generateMoves(moves);
     for (const auto &move : moves)
     {
       game.applyMove(move);
@@ -34,148 +142,581 @@ public:
       game.undoMove(move);
     }
 
+    if (hash)
+    {
+      hash->store(game.getZobristKey(), depth, nodes);
+    }
     return nodes;
   }
 
-  // Divide function - shows move breakdown at depth 1
-  void divide(int depth)
+  // Splits the tree below the root (and below each root move once the tree
+  // is deep enough to be worth it) into tasks that workers pull from a shared
+  // counter. Every worker searches on its own copy of the game, so nothing
+  // is shared but the task list, and the sum is identical to perft().
+  uint64_t perftParallel(int depth)
+  {
+    if (depth < 2)
+    {
+      return perft(depth);
+    }
+
+    std::vector<PerftTask> tasks;
+    ChessGame::MoveList moves;
+    game.generateMoves(moves);
+    for (const auto &move : moves)
+    {
+      if (depth < 4)
+      {
+        tasks.push_back({{move, ChessGame::Move{}}, 1, 0});
+        continue;
+      }
+      // Root moves alone balance poorly: a few of them hold most of the tree
+      ChessGame::MoveList replies;
+      game.applyMove(move);
+      game.generateMoves(replies);
+      for (const auto &reply : replies)
+      {
+        tasks.push_back({{move, reply}, 2, 0});
+      }
+      game.undoMove(move);
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+      ChessGame copy = game; // Independent state stack, nothing is shared with other workers
+      PerftTester tester(copy);
+      tester.setHash(hash);
+      for (size_t i = next++; i < tasks.size(); i = next++)
+      {
+        PerftTask &task = tasks[i];
+        for (int ply = 0; ply < task.length; ++ply)
+        {
+          copy.applyMove(task.path[ply]);
+        }
+        task.nodes = tester.perft(depth - task.length);
+        for (int ply = task.length - 1; ply >= 0; --ply)
+        {
+          copy.undoMove(task.path[ply]);
+        }
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i)
+    {
+      pool.emplace_back(worker);
+    }
+    for (std::thread &thread : pool)
+    {
+      thread.join();
+    }
+
+    uint64_t nodes = 0;
+    for (const PerftTask &task : tasks)
+    {
+      nodes += task.nodes;
+    }
+    return nodes;
+  }
+
+  // Debug self-check: walks the perft tree and compares the incremental
+  // Zobrist key against a from-scratch recomputation at every node.
+  // Returns the number of nodes where they disagree.
+  uint64_t verifyZobristKeys(int depth)
+  {
+    // The evaluation terms are maintained alongside the key, so they are checked with it
+    bool mismatch = game.getZobristKey() != game.computeZobristKey() ||
+                    game.getMaterialScore() != game.computeMaterialScore() ||
+                    game.getPieceSquareScore() != game.computePieceSquareScore();
+    uint64_t mismatches = mismatch ? 1 : 0;
+    if (depth == 0)
+    {
+      return mismatches;
+    }
+
+    ChessGame::MoveList moves;
+    game.generateMoves(moves);
+    for (const auto &move : moves)
+    {
+      game.applyMove(move);
+      mismatches += verifyZobristKeys(depth - 1);
+      game.undoMove(move);
+    }
+    return mismatches;
+  }
+
+  // Debug self-check for the generators. At every node of the perft tree the
+  // pseudo-legal list filtered by isLegal() must equal generateMoves(), and
+  // isPseudoLegal() must accept exactly the pseudo-legal moves: every move
+  // of the list, and among `foreign` (the parent's moves, the kind of move a
+  // hash entry or killer brings in) only those the list contains. The
+  // staged lists must split it too: generateCaptures() and generateQuiets()
+  // together give generateMoves() with no move in both. seeGE() must also
+  // agree with see() on every capture at a few thresholds. With `exhaustive`
+  // every 16-bit encoding is tried. Returns the failing nodes.
+  uint64_t verifyMoveGeneration(int depth, const ChessGame::MoveList &foreign, bool exhaustive = false)
+  {
+    ChessGame::MoveList legal, pseudo, filtered;
+    game.generateMoves(legal);
+    game.generatePseudoLegalMoves(pseudo);
+    for (const auto &move : pseudo)
+    {
+      if (game.isLegal(move))
+      {
+        filtered.push_back(move);
+      }
+    }
+    std::vector<uint16_t> pseudoSet = sortedMoves(pseudo);
+
+    ChessGame::MoveList staged;
+    game.generateCaptures(staged);
+    ChessGame::MoveList quiets;
+    game.generateQuiets(quiets);
+    for (const auto &move : quiets)
+    {
+      staged.push_back(move);
+    }
+
+    // Both lists sort the same only if nothing is missing or generated twice
+    std::vector<uint16_t> legalSet = sortedMoves(legal);
+    bool mismatch = legalSet != sortedMoves(filtered) || legalSet != sortedMoves(staged);
+    auto acceptsCorrectly = [&](const ChessGame::Move &move)
+    {
+      return game.isPseudoLegal(move) == std::binary_search(pseudoSet.begin(), pseudoSet.end(), move.data);
+    };
+    for (const auto &move : pseudo)
+    {
+      mismatch = mismatch || !game.isPseudoLegal(move);
+    }
+    for (const auto &move : foreign)
+    {
+      mismatch = mismatch || !acceptsCorrectly(move);
+    }
+    for (const auto &move : legal)
+    {
+      if (!move.isCapture())
+      {
+        continue;
+      }
+      // seeGE() stops as soon as the outcome is settled, so test it around the exact value too
+      int value = game.see(move);
+      for (int threshold : {-500, -100, 0, 1, 100, 500, value, value + 1})
+      {
+        mismatch = mismatch || game.seeGE(move, threshold) != (value >= threshold);
+      }
+    }
+    for (uint32_t data = 0; exhaustive && data <= 0xFFFF; ++data)
+    {
+      ChessGame::Move move;
+      move.data = static_cast<uint16_t>(data);
+      mismatch = mismatch || !acceptsCorrectly(move);
+    }
+
+    uint64_t mismatches = mismatch ? 1 : 0;
+    if (depth == 0)
+    {
+      return mismatches;
+    }
+    for (const auto &move : legal)
+    {
+      game.applyMove(move);
+      mismatches += verifyMoveGeneration(depth - 1, pseudo);
+      game.undoMove(move);
+    }
+    return mismatches;
+  }
+
+  // Divide: the node count below each root move, in UCI notation so the
+  // output can be diffed against another engine's divide
+  uint64_t divide(int depth)
   {
     if (depth <= 0)
     {
       std::cout << "Invalid depth for divide" << std::endl;
-      return;
+      return 0;
     }
 
-    std::vector<ChessGame::Move> moves = game.generateMoves();
+    ChessGame::MoveList moves;
+    game.generateMoves(moves);
     uint64_t totalNodes = 0;
 
-    std::cout << "\nDivide results for depth " << depth << ":" << std::endl;
-    std::cout << "Move\t\tNodes" << std::endl;
-    std::cout << "----\t\t-----" << std::endl;
-
     for (const auto &move : moves)
     {
       game.applyMove(move);
-      uint64_t nodes = (depth == 1) ? 1 : perft(depth - 1);
+      uint64_t nodes = count(depth - 1);
       game.undoMove(move);
 
-      // You might want to implement a toString() method for your Move struct
-      // For now, this assumes you can output the move directly
-      std::cout << "Move\t\t" << nodes << std::endl;
+      std::cout << ChessGame::moveToString(move) << ": " << nodes << std::endl;
       totalNodes += nodes;
     }
 
-    std::cout << "----\t\t-----" << std::endl;
-    std::cout << "Total:\t\t" << totalNodes << std::endl;
+    std::cout << "\nMoves: " << moves.size() << std::endl;
+    std::cout << "Nodes: " << totalNodes << std::endl;
+    return totalNodes;
   }
 
-  // Timed perft test with results display
-  void runPerftTest(int maxDepth)
+  // Runs the same perft once per sliding attack backend so they can be compared
+  // on this host. Node counts must match; only the timing should differ.
+  void compareSliderBackends(int depth)
   {
-    std::cout << "Running Perft Test:" << std::endl;
-    std::cout << "Depth\tNodes\t\tTime (ms)\tNPS" << std::endl;
-    std::cout << "-----\t-----\t\t---------\t---" << std::endl;
+    SliderBackend original = Attacks::backend();
 
-    for (int depth = 1; depth <= maxDepth; depth++)
+    std::cout << "Backend\tNodes\t\tTime (ms)\tNPS" << std::endl;
+    std::cout << "-------\t-----\t\t---------\t---" << std::endl;
+
+    for (SliderBackend backend : {SliderBackend::Magic, SliderBackend::Pext})
     {
+      if (!Attacks::setBackend(backend))
+      {
+        std::cout << Attacks::backendName(backend) << "\tunavailable (this CPU has no BMI2)" << std::endl;
+        continue;
+      }
+
       auto start = std::chrono::high_resolution_clock::now();
       uint64_t nodes = perft(depth);
       auto end = std::chrono::high_resolution_clock::now();
 
       auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
       double timeMs = duration.count();
-
       uint64_t nps = (timeMs > 0) ? (nodes * 1000) / timeMs : 0;
 
-      std::cout << depth << "\t" << nodes << "\t\t"
+      std::cout << Attacks::backendName(backend) << "\t" << nodes << "\t\t"
                 << std::fixed << std::setprecision(2) << timeMs << "\t\t"
                 << nps << std::endl;
     }
+
+    Attacks::setBackend(original);
   }
 
-  // Verify against known perft results for starting position
-  void verifyStartingPosition()
+  // Runs the Zobrist self-check on a few positions that exercise castling,
+  // en passant and promotions
+  void verifyZobristPositions(int depth)
   {
-    // Standard starting position perft results
-    uint64_t expected[] = {
-        0,        // depth 0 (not used)
-        20,       // depth 1
-        400,      // depth 2
-        8902,     // depth 3
-        197281,   // depth 4
-        4865609,  // depth 5
-        119060324 // depth 6
+    const char *fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
     };
 
-    std::cout << "\nVerifying starting position perft results:" << std::endl;
-    std::cout << "Depth\tExpected\tActual\t\tResult" << std::endl;
-    std::cout << "-----\t--------\t------\t\t------" << std::endl;
-
+    std::cout << "\nVerifying incremental Zobrist keys and evaluation terms (depth " << depth << "):" << std::endl;
     bool allCorrect = true;
-    for (int depth = 1; depth <= 6; depth++)
+    for (const char *fen : fens)
     {
-      uint64_t actual = perft(depth);
-      bool correct = (actual == expected[depth]);
-      allCorrect = allCorrect && correct;
-
-      std::cout << depth << "\t" << expected[depth] << "\t\t"
-                << actual << "\t\t" << (correct ? "PASS" : "FAIL") << std::endl;
+      ChessGame position;
+      position.parseFEN(fen);
+      uint64_t mismatches = PerftTester(position).verifyZobristKeys(depth);
+      allCorrect = allCorrect && mismatches == 0;
+      std::cout << (mismatches == 0 ? "PASS" : "FAIL") << "\t" << mismatches << " mismatches\t" << fen << std::endl;
     }
 
     std::cout << "\nOverall result: " << (allCorrect ? "PASS" : "FAIL") << std::endl;
   }
 };
 
-// Test function for a specific position
-void testPosition(ChessGame &game, int depth)
+// One EPD line: a position and its expected node counts (";D<depth> <nodes>")
+struct EpdPosition
 {
-  PerftTester tester(game);
+  std::string fen;
+  std::vector<std::pair<int, uint64_t>> expected; // (depth, nodes), in file order
+};
 
-  std::cout << "=== Perft Test ===" << std::endl;
-  tester.runPerftTest(depth);
+// Reads an EPD file; blank lines and lines starting with '#' are skipped
+std::vector<EpdPosition> readEpd(const std::string &path)
+{
+  std::ifstream file(path);
+  if (!file)
+  {
+    throw std::runtime_error("cannot open " + path);
+  }
 
-  std::cout << "\n=== Divide Test ===" << std::endl;
-  tester.divide(depth);
+  std::vector<EpdPosition> positions;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    size_t operations = line.find(';');
+    EpdPosition position;
+    std::istringstream fields(line.substr(0, operations));
+    std::string placement, color, castling, enPassant;
+    fields >> placement >> color >> castling >> enPassant;
+    position.fen = placement + " " + color + " " + castling + " " + enPassant + " 0 1"; // EPD has no move counters
+
+    while (operations != std::string::npos)
+    {
+      size_t next = line.find(';', operations + 1);
+      std::istringstream operation(line.substr(operations + 1, next == std::string::npos ? std::string::npos : next - operations - 1));
+      std::string name;
+      uint64_t nodes;
+      if (operation >> name >> nodes && name.size() > 1 && name[0] == 'D')
+      {
+        position.expected.emplace_back(std::stoi(name.substr(1)), nodes);
+      }
+      operations = next;
+    }
+    positions.push_back(position);
+  }
+  return positions;
 }
 
-// Test starting position
-void testStartingPosition(ChessGame &game)
+// Runs the generator self-check below every suite position; the root of each
+// position also tries every move encoding against isPseudoLegal()
+bool verifyMoveGenerationSuite(const std::vector<EpdPosition> &positions, int depth)
 {
-  PerftTester tester(game);
+  std::cout << "Verifying move generation consistency (depth " << depth << "):" << std::endl;
+  bool allCorrect = true;
+  for (const EpdPosition &position : positions)
+  {
+    ChessGame game;
+    game.parseFEN(position.fen);
+    uint64_t mismatches = PerftTester(game).verifyMoveGeneration(depth, ChessGame::MoveList(), true);
+    allCorrect = allCorrect && mismatches == 0;
+    std::cout << (mismatches == 0 ? "PASS" : "FAIL") << "\t" << mismatches << " mismatches\t" << position.fen << std::endl;
+  }
+  return allCorrect;
+}
 
-  std::cout << "=== Starting Position Verification ===" << std::endl;
-  tester.verifyStartingPosition();
+// Hand-worked exchanges the suite positions do not isolate
+bool verifySeeExchanges()
+{
+  struct Exchange
+  {
+    const char *fen;
+    const char *move;
+    int expected;
+  };
+  const Exchange exchanges[] = {
+      {"3r3k/8/8/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5", 100},   // Rd1 recaptures through Rd2 (x-ray)
+      {"4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 0},     // En passant, the c-pawn recaptures
+      {"r3k3/1P6/1n6/8/8/8/8/4K3 w - - 0 1", "b7a8q", 400},   // Rook and promotion won, the queen lost
+  };
+
+  std::cout << "\nVerifying static exchange evaluation:" << std::endl;
+  bool allCorrect = true;
+  for (const Exchange &exchange : exchanges)
+  {
+    ChessGame game;
+    game.parseFEN(exchange.fen);
+    ChessGame::Move move = game.moveFromString(exchange.move);
+    int value = game.see(move);
+    bool correct = value == exchange.expected && game.seeGE(move, value) && !game.seeGE(move, value + 1);
+    allCorrect = allCorrect && correct;
+    std::cout << (correct ? "PASS" : "FAIL") << "\t" << exchange.move << " = " << value << " (expected "
+              << exchange.expected << ")\t" << exchange.fen << std::endl;
+  }
+  return allCorrect;
 }
 
-int main()
+struct SuiteResult
 {
+  std::string fen;
+  int depth;
+  uint64_t nodes;
+  uint64_t expected;
+  double timeMs;
+};
+
+static uint64_t nodesPerSecond(uint64_t nodes, double timeMs)
+{
+  return timeMs > 0 ? static_cast<uint64_t>(nodes * 1000.0 / timeMs) : 0;
+}
+
+// Runs every expectation up to maxDepth and prints one line per run
+std::vector<SuiteResult> runSuite(const std::vector<EpdPosition> &positions, int maxDepth, int threads, PerftHash *hash)
+{
+  std::vector<SuiteResult> results;
+  std::cout << "Result\tDepth\tNodes\t\tTime (ms)\tNPS\t\tPosition" << std::endl;
+  for (const EpdPosition &position : positions)
+  {
+    ChessGame game;
+    game.parseFEN(position.fen);
+    PerftTester tester(game, threads);
+    tester.setHash(hash);
+
+    for (const auto &[depth, expected] : position.expected)
+    {
+      if (depth > maxDepth)
+      {
+        continue;
+      }
+      auto start = std::chrono::high_resolution_clock::now();
+      uint64_t nodes = tester.count(depth);
+      auto end = std::chrono::high_resolution_clock::now();
+      double timeMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+      results.push_back({position.fen, depth, nodes, expected, timeMs});
+      std::cout << (nodes == expected ? "PASS" : "FAIL") << "\t" << depth << "\t" << nodes << "\t\t"
+                << std::fixed << std::setprecision(2) << timeMs << "\t\t"
+                << nodesPerSecond(nodes, timeMs) << "\t" << position.fen << std::endl;
+      if (nodes != expected)
+      {
+        std::cout << "\texpected " << expected << std::endl;
+      }
+    }
+  }
+  return results;
+}
+
+// Machine-readable copy of the suite results for the perf dashboard
+void writeJson(const std::string &path, const std::vector<SuiteResult> &results, int threads, size_t hashMegabytes)
+{
+  std::ofstream out(path);
+  if (!out)
+  {
+    throw std::runtime_error("cannot write " + path);
+  }
+
+  uint64_t totalNodes = 0;
+  double totalMs = 0;
+  bool allPassed = true;
+  out << "{\n  \"threads\": " << threads << ",\n  \"hash_mb\": " << hashMegabytes << ",\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const SuiteResult &r = results[i];
+    totalNodes += r.nodes;
+    totalMs += r.timeMs;
+    allPassed = allPassed && r.nodes == r.expected;
+    out << "    {\"fen\": \"" << r.fen << "\", \"depth\": " << r.depth << ", \"nodes\": " << r.nodes
+        << ", \"expected\": " << r.expected << ", \"pass\": " << (r.nodes == r.expected ? "true" : "false")
+        << ", \"time_ms\": " << std::fixed << std::setprecision(3) << r.timeMs
+        << ", \"nps\": " << nodesPerSecond(r.nodes, r.timeMs) << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ],\n  \"total_nodes\": " << totalNodes << ",\n  \"total_time_ms\": " << totalMs
+      << ",\n  \"nps\": " << nodesPerSecond(totalNodes, totalMs) << ",\n  \"pass\": " << (allPassed ? "true" : "false") << "\n}\n";
+}
+
+static void usage(const char *program)
+{
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --epd FILE      suite to run (default src/testing/perft.epd)\n"
+            << "  --depth N       deepest expectation to check, or the divide depth with --fen (default 5)\n"
+            << "  --fen FEN       divide a single position instead of running the suite\n"
+            << "  --json FILE     also write the suite results as JSON\n"
+            << "  --threads N     worker threads (default one per hardware thread)\n"
+            << "  --hash MB       cache subtree counts in a table of MB megabytes (default off)\n"
+            << "  --zobrist       check incremental Zobrist keys and eval terms against recomputation\n"
+            << "  --backends      compare the magic and PEXT slider backends\n"
+            << "  --consistency   cross-check the legal, pseudo-legal, staged and isPseudoLegal() generators and\n"
+            << "                  see()/seeGE() over the suite to --depth (default 3 in this mode)" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  std::string epdPath = "src/testing/perft.epd";
+  std::string fen;
+  std::string jsonPath;
+  int depth = 5;
+  int threads = static_cast<int>(std::thread::hardware_concurrency());
+  size_t hashMegabytes = 0;
+  bool checkZobrist = false;
+  bool compareBackends = false;
+  bool checkConsistency = false;
+  bool depthGiven = false;
+
   try
   {
-    // Create your chess game instance
-    ChessGame game;                                                            // Assumes default constructor sets up starting position
-    game.parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"); // Reset to starting position
-    game.preworkPosition();                                                    // Prepare the game state
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (arg == "--epd" && hasValue)
+        epdPath = argv[++i];
+      else if (arg == "--depth" && hasValue)
+      {
+        depth = std::stoi(argv[++i]);
+        depthGiven = true;
+      }
+      else if (arg == "--fen" && hasValue)
+        fen = argv[++i];
+      else if (arg == "--json" && hasValue)
+        jsonPath = argv[++i];
+      else if ((arg == "--threads" || arg == "-t") && hasValue)
+        threads = std::stoi(argv[++i]);
+      else if (arg == "--hash" && hasValue)
+        hashMegabytes = std::stoul(argv[++i]);
+      else if (arg == "--zobrist")
+        checkZobrist = true;
+      else if (arg == "--backends")
+        compareBackends = true;
+      else if (arg == "--consistency")
+        checkConsistency = true;
+      else
+      {
+        usage(argv[0]);
+        return 1;
+      }
+    }
+
+    std::unique_ptr<PerftHash> hash;
+    if (hashMegabytes > 0)
+    {
+      hash = std::make_unique<PerftHash>(hashMegabytes);
+    }
+
+    if (checkZobrist || compareBackends)
+    {
+      ChessGame game;
+      game.parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+      if (checkZobrist)
+      {
+        PerftTester(game).verifyZobristPositions(4);
+      }
+      if (compareBackends)
+      {
+        std::cout << "\n=== Slider Backend Comparison (default: " << Attacks::backendName(Attacks::backend()) << ") ===" << std::endl;
+        PerftTester(game).compareSliderBackends(depth);
+      }
+      return 0;
+    }
 
-    std::cout << "Chess Engine Perft Tester" << std::endl;
-    std::cout << "=========================" << std::endl;
+    if (checkConsistency)
+    {
+      // Every node is generated three ways, so the perft depths would take too long
+      bool generatorsCorrect = verifyMoveGenerationSuite(readEpd(epdPath), depthGiven ? depth : 3);
+      bool exchangesCorrect = verifySeeExchanges();
+      std::cout << "\nOverall result: " << (generatorsCorrect && exchangesCorrect ? "PASS" : "FAIL") << std::endl;
+      return generatorsCorrect && exchangesCorrect ? 0 : 1;
+    }
 
-    // Test starting position
-    testStartingPosition(game);
+    if (!fen.empty())
+    {
+      ChessGame game;
+      game.parseFEN(fen);
+      PerftTester tester(game, threads);
+      tester.setHash(hash.get());
+      tester.divide(depth);
+      return 0;
+    }
 
-    // You can also test specific positions by setting up the game state
-    // game.setPosition("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    std::vector<SuiteResult> results = runSuite(readEpd(epdPath), depth, threads, hash.get());
+    if (!jsonPath.empty())
+    {
+      writeJson(jsonPath, results, threads, hashMegabytes);
+    }
 
-    // Run performance test
-    std::cout << "\n=== Performance Test ===" << std::endl;
-    testPosition(game, 6); // Test up to depth 5
+    uint64_t totalNodes = 0;
+    double totalMs = 0;
+    int failures = 0;
+    for (const SuiteResult &r : results)
+    {
+      totalNodes += r.nodes;
+      totalMs += r.timeMs;
+      failures += r.nodes != r.expected;
+    }
+    std::cout << "\n"
+              << results.size() << " runs, " << failures << " failed, " << totalNodes << " nodes in "
+              << std::fixed << std::setprecision(2) << totalMs << " ms (" << nodesPerSecond(totalNodes, totalMs) << " nps)" << std::endl;
+    return failures == 0 ? 0 : 1; // Non-zero exit fails the regression gate
   }
   catch (const std::exception &e)
   {
     std::cerr << "Error: " << e.what() << std::endl;
     return 1;
   }
-
-  return 0;
 }
 
-// Compile with: g++ -std=c++11 -O3 -o perft perft.cpp ChessGame.cpp
\ No newline at end of file
+// Build with `make perft`, or: g++ -std=c++17 -O3 -pthread -o perft perft.cpp ../chess.cpp ../attacks.cpp
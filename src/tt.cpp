@@ -0,0 +1,130 @@
+#include "./tt.h"
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+    size_t wanted = megabytes * 1024 * 1024 / sizeof(Bucket);
+    size_t count = 1;
+    while (count * 2 <= wanted)
+    {
+        count *= 2; // Power of two, so the bucket index is a mask of the key
+    }
+    if (count == bucketCount)
+    {
+        clear();
+        return;
+    }
+    buckets.reset(); // Free the old table before allocating the new one
+    buckets.reset(new Bucket[count]); // Over-aligned new keeps every bucket on its own cache line; entries start empty
+    bucketCount = count;
+    generation = 0;
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i < bucketCount; ++i)
+    {
+        for (Entry &entry : buckets[i].entries)
+        {
+            entry.keyXorData.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+uint64_t TranspositionTable::pack(ChessGame::Move move, int score, int depth, Bound bound, uint8_t age)
+{
+    return static_cast<uint64_t>(move.data) |
+           (static_cast<uint64_t>(static_cast<uint32_t>(score)) << 16) |
+           (static_cast<uint64_t>(depth & 0xFF) << 48) |
+           (static_cast<uint64_t>(bound) << 56) |
+           (static_cast<uint64_t>(age & AGE_MASK) << 58);
+}
+
+TTData TranspositionTable::unpack(uint64_t data)
+{
+    TTData result;
+    result.move.data = static_cast<uint16_t>(data);
+    result.score = static_cast<int32_t>(static_cast<uint32_t>(data >> 16));
+    result.depth = depthOf(data);
+    result.bound = static_cast<Bound>((data >> 56) & 0x3);
+    return result;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData &data) const
+{
+    for (const Entry &entry : bucketFor(key).entries)
+    {
+        uint64_t stored = entry.data.load(std::memory_order_relaxed);
+        // A half-written entry fails this check, so it reads as a miss
+        if ((entry.keyXorData.load(std::memory_order_relaxed) ^ stored) == key && stored != 0)
+        {
+            data = unpack(stored);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, ChessGame::Move move, int score, int depth, Bound bound)
+{
+    Entry *replace = nullptr;
+    int replaceValue = 0;
+    for (Entry &entry : bucketFor(key).entries)
+    {
+        uint64_t stored = entry.data.load(std::memory_order_relaxed);
+        if (stored == 0)
+        {
+            replace = &entry;
+            break;
+        }
+        if ((entry.keyXorData.load(std::memory_order_relaxed) ^ stored) == key)
+        {
+            // A shallower bound from this search, e.g. reached by transposition, must not evict deeper work
+            if (ageOf(stored) == generation && depthOf(stored) > depth && bound != Bound::Exact)
+            {
+                return;
+            }
+            if (move == ChessGame::Move{})
+            {
+                move = unpack(stored).move; // Keep the old best move rather than forget it
+            }
+            replace = &entry;
+            break;
+        }
+
+        // Otherwise evict the shallowest entry, counting every search it is older as 8 plies less
+        int age = (generation - ageOf(stored)) & AGE_MASK;
+        int value = depthOf(stored) - 8 * age;
+        if (!replace || value < replaceValue)
+        {
+            replace = &entry;
+            replaceValue = value;
+        }
+    }
+
+    uint64_t data = pack(move, score, depth, bound, generation);
+    replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    int used = 0;
+    int sampled = 0;
+    for (size_t i = 0; i < bucketCount && sampled < 1000; ++i)
+    {
+        for (const Entry &entry : buckets[i].entries)
+        {
+            uint64_t stored = entry.data.load(std::memory_order_relaxed);
+            used += stored != 0 && ageOf(stored) == generation;
+            ++sampled;
+        }
+    }
+    return sampled ? used * 1000 / sampled : 0;
+}
@@ -0,0 +1,86 @@
+#ifndef TT_H
+#define TT_H
+
+#include "./chess.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// How a stored score relates to the true score of the position
+enum class Bound : uint8_t
+{
+    None,  // Empty entry
+    Upper, // Every move failed low: score >= true score
+    Lower, // A move failed high: score <= true score
+    Exact,
+};
+
+// What a probe hands back; only meaningful when probe() returned true
+struct TTData
+{
+    ChessGame::Move move; // Best or refuting move, Move{} if none was found
+    int score;
+    int depth;
+    Bound bound;
+};
+
+// Transposition table keyed by the Zobrist key. Entries live in buckets of
+// four that fill exactly one cache line, so a probe touches a single line.
+// Each entry stores its key XORed with its data and checks it on probe, so
+// a torn write from another thread reads as a miss rather than as a wrong
+// entry: the table can be shared by several searching threads without locks.
+class TranspositionTable
+{
+public:
+    explicit TranspositionTable(size_t megabytes = 16);
+
+    // Reallocates to the largest power of two number of buckets that fits in
+    // `megabytes` (at least one bucket) and clears the table
+    void resize(size_t megabytes);
+    void clear();
+
+    // Call once per search, so entries from earlier searches age out first
+    void newSearch() { generation = (generation + 1) & AGE_MASK; }
+
+    bool probe(uint64_t key, TTData &data) const;
+    // An entry for the same key is kept if it is from this search, deeper, and the new
+    // bound is not Exact. Otherwise the key's entry, an empty slot or the shallowest
+    // and oldest entry of the bucket is replaced.
+    void store(uint64_t key, ChessGame::Move move, int score, int depth, Bound bound);
+
+    size_t sizeInBytes() const { return bucketCount * sizeof(Bucket); }
+
+    // Permille of the first 1000 entries written by the current search (UCI "hashfull")
+    int hashfull() const;
+
+private:
+    static constexpr int ENTRIES_PER_BUCKET = 4;
+    static constexpr uint8_t AGE_MASK = 0x3F; // 6 bits, the other 2 bits of that byte hold the bound
+
+    // data layout: move (bits 0-15), score (16-47), depth (48-55), bound (56-57), age (58-63)
+    struct Entry
+    {
+        std::atomic<uint64_t> keyXorData{0};
+        std::atomic<uint64_t> data{0};
+    };
+
+    struct alignas(64) Bucket
+    {
+        Entry entries[ENTRIES_PER_BUCKET];
+    };
+    static_assert(sizeof(Bucket) == 64, "A bucket must fill exactly one cache line");
+
+    static uint64_t pack(ChessGame::Move move, int score, int depth, Bound bound, uint8_t age);
+    static TTData unpack(uint64_t data);
+    static uint8_t ageOf(uint64_t data) { return static_cast<uint8_t>(data >> 58); }
+    static int depthOf(uint64_t data) { return static_cast<uint8_t>(data >> 48); }
+
+    Bucket &bucketFor(uint64_t key) const { return buckets[key & (bucketCount - 1)]; }
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketCount = 0;
+    uint8_t generation = 0;
+};
+
+#endif // TT_H
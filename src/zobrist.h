@@ -0,0 +1,55 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+// Zobrist keys: a position's hash is the XOR of one random key per feature
+// (piece on square, castling rights, en passant file, side to move), so a move
+// only XORs out what it removes and XORs in what it adds. The keys are
+// generated at compile time from a fixed seed, so hashes match across runs.
+namespace Zobrist
+{
+    struct Keys
+    {
+        uint64_t pieceSquare[12][64]; // [bitboard index (prnbqkPRNBQK)][square]
+        uint64_t castling[16];        // One per castling rights value (KQkq bits)
+        uint64_t enPassantFile[8];    // Only hashed while a pawn can actually capture en passant
+        uint64_t blackToMove;
+    };
+
+    // SplitMix64, a small generator with well mixed 64 bit outputs
+    constexpr uint64_t splitMix64(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    constexpr Keys makeKeys()
+    {
+        Keys keys = {};
+        uint64_t state = 0x456E6F6B69ULL; // Fixed seed
+        for (int piece = 0; piece < 12; ++piece)
+        {
+            for (int sq = 0; sq < 64; ++sq)
+            {
+                keys.pieceSquare[piece][sq] = splitMix64(state);
+            }
+        }
+        for (int rights = 0; rights < 16; ++rights)
+        {
+            keys.castling[rights] = splitMix64(state);
+        }
+        for (int file = 0; file < 8; ++file)
+        {
+            keys.enPassantFile[file] = splitMix64(state);
+        }
+        keys.blackToMove = splitMix64(state);
+        return keys;
+    }
+
+    inline constexpr Keys keys = makeKeys();
+}
+
+#endif // ZOBRIST_H